@@ -60,4 +60,97 @@ struct aChunk
 	{
 		return (getDataPtr() - getAlignedPtr<char>(align)) + Size;
 	}
-};
\ No newline at end of file
+
+	aChunk* getNextChunk() const
+	{
+		return (aChunk*)(getDataPtr() + Size);
+	}
+
+	class aChunkRange getChildren() const;
+};
+
+// Walks over chunks placed in [begin; end) memory range. Every step checks that the chunk
+// lies entirely inside the range, so malformed or truncated data just ends the walk.
+// Empty chunks (Id 0) are alignment padding between chunks and are skipped, padding inside
+// the data of a chunk depends on its id and is skipped by GetChunkData (bb_chunk.h).
+class aChunkIterator
+{
+private:
+	aChunk* current;
+	char* endPtr;
+
+	aChunk* findValidChunk(aChunk* chunk) const
+	{
+		while (true) {
+			const std::ptrdiff_t bytesLeft = endPtr - (char*)chunk;
+			if (bytesLeft < (std::ptrdiff_t)sizeof(aChunk) || chunk->Size < 0 || chunk->Size > bytesLeft - (std::ptrdiff_t)sizeof(aChunk)) {
+				return (aChunk*)endPtr;
+			}
+
+			if (chunk->Id != 0) {
+				return chunk;
+			}
+
+			chunk = chunk->getNextChunk();
+		}
+	}
+
+public:
+	aChunkIterator(char* inBeginPtr, char* inEndPtr)
+		: endPtr(inEndPtr)
+	{
+		current = findValidChunk((aChunk*)inBeginPtr);
+	}
+
+	aChunk& operator*() const
+	{
+		return *current;
+	}
+
+	aChunk* operator->() const
+	{
+		return current;
+	}
+
+	aChunkIterator& operator++()
+	{
+		current = findValidChunk(current->getNextChunk());
+		return *this;
+	}
+
+	bool operator==(const aChunkIterator& other) const
+	{
+		return current == other.current;
+	}
+
+	bool operator!=(const aChunkIterator& other) const
+	{
+		return current != other.current;
+	}
+};
+
+class aChunkRange
+{
+private:
+	char* beginPtr;
+	char* endPtr;
+
+public:
+	aChunkRange(char* inBeginPtr, char* inEndPtr)
+		: beginPtr(inBeginPtr), endPtr(inEndPtr) {}
+
+	aChunkIterator begin() const
+	{
+		return aChunkIterator(beginPtr, endPtr);
+	}
+
+	aChunkIterator end() const
+	{
+		return aChunkIterator(endPtr, endPtr);
+	}
+};
+
+inline aChunkRange aChunk::getChildren() const
+{
+	return aChunkRange(getDataPtr(), getDataPtr() + Size);
+}
\ No newline at end of file
@@ -0,0 +1,424 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#if BB_X86
+#include <immintrin.h>
+#endif
+
+/*
+	BC1-BC3 decoding with D3D rounding rules:
+		color2 = (2 * color0 + color1 + 1) / 3, color3 = (color0 + 2 * color1 + 1) / 3
+		or in BC1 punch-through mode color2 = (color0 + color1 + 1) / 2, color3 = transparent black
+		alpha[i] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7
+		or alpha[i] = ((5 - i) * alpha0 + i * alpha1 + 2) / 5, alpha6 = 0, alpha7 = 255
+
+	Vector and scalar paths produce the same output.
+*/
+
+namespace bb
+{
+
+static std::uint16_t
+ReadShort(const std::uint8_t* data)
+{
+	std::uint16_t value = 0;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static std::uint32_t
+ReadLong(const std::uint8_t* data)
+{
+	std::uint32_t value = 0;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static std::uint64_t
+ReadAlphaIndices(const std::uint8_t* block)
+{
+	std::uint64_t indices = 0;
+	std::memcpy(&indices, block + 2, 6);
+	return indices;
+}
+
+static void
+DecodeColorPaletteScalar(const std::uint8_t* block, bool onlyOpaque, std::uint8_t palette[4][4])
+{
+	const std::uint16_t c0 = ReadShort(block);
+	const std::uint16_t c1 = ReadShort(block + 2);
+	const std::uint16_t endpoints[2] = { c0, c1 };
+
+	for (std::int32_t i = 0; i < 2; i++) {
+		palette[i][0] = static_cast<std::uint8_t>((((endpoints[i] >> 11) & 0x1F) * 527 + 23) >> 6);
+		palette[i][1] = static_cast<std::uint8_t>((((endpoints[i] >> 5) & 0x3F) * 259 + 33) >> 6);
+		palette[i][2] = static_cast<std::uint8_t>(((endpoints[i] & 0x1F) * 527 + 23) >> 6);
+		palette[i][3] = 0xFF;
+	}
+
+	for (std::int32_t channel = 0; channel < 4; channel++) {
+		const std::uint32_t color0 = palette[0][channel];
+		const std::uint32_t color1 = palette[1][channel];
+		if (c0 > c1 || onlyOpaque) {
+			palette[2][channel] = static_cast<std::uint8_t>((2 * color0 + color1 + 1) / 3);
+			palette[3][channel] = static_cast<std::uint8_t>((color0 + 2 * color1 + 1) / 3);
+		} else {
+			palette[2][channel] = static_cast<std::uint8_t>((color0 + color1 + 1) / 2);
+			palette[3][channel] = 0;
+		}
+	}
+}
+
+static void
+DecodeAlphaPaletteScalar(const std::uint8_t* block, std::uint8_t palette[8])
+{
+	const std::uint32_t alpha0 = block[0];
+	const std::uint32_t alpha1 = block[1];
+	palette[0] = static_cast<std::uint8_t>(alpha0);
+	palette[1] = static_cast<std::uint8_t>(alpha1);
+
+	if (alpha0 > alpha1) {
+		for (std::uint32_t i = 1; i < 7; i++) {
+			palette[i + 1] = static_cast<std::uint8_t>(((7 - i) * alpha0 + i * alpha1 + 3) / 7);
+		}
+	} else {
+		for (std::uint32_t i = 1; i < 5; i++) {
+			palette[i + 1] = static_cast<std::uint8_t>(((5 - i) * alpha0 + i * alpha1 + 2) / 5);
+		}
+
+		palette[6] = 0;
+		palette[7] = 0xFF;
+	}
+}
+
+static void
+DecodeBlockScalar(ENFSTextureFormat format, const std::uint8_t* block, std::uint8_t* dst, std::size_t dstPitch)
+{
+	const std::uint8_t* colorBlock = format == ENFSTextureFormat::BC1 ? block : block + 8;
+	std::uint8_t colorPalette[4][4] = {};
+	std::uint8_t alphaPalette[8] = {};
+	DecodeColorPaletteScalar(colorBlock, format != ENFSTextureFormat::BC1, colorPalette);
+	if (format == ENFSTextureFormat::BC3) {
+		DecodeAlphaPaletteScalar(block, alphaPalette);
+	}
+
+	std::uint32_t colorIndices = ReadLong(colorBlock + 4);
+	std::uint64_t alphaIndices = ReadAlphaIndices(block);
+	for (std::int32_t y = 0; y < 4; y++) {
+		std::uint8_t* pixel = dst + y * dstPitch;
+		for (std::int32_t x = 0; x < 4; x++) {
+			std::memcpy(pixel, colorPalette[colorIndices & 3], 4);
+			colorIndices >>= 2;
+
+			if (format == ENFSTextureFormat::BC2) {
+				pixel[3] = static_cast<std::uint8_t>(((ReadShort(block + y * 2) >> (x * 4)) & 0x0F) * 17);
+			} else if (format == ENFSTextureFormat::BC3) {
+				pixel[3] = alphaPalette[alphaIndices & 7];
+				alphaIndices >>= 3;
+			}
+
+			pixel += 4;
+		}
+	}
+}
+
+static void
+DecodeBlocksRowScalar(ENFSTextureFormat format, const std::uint8_t* blocks, std::size_t blocksCount, std::uint8_t* dst, std::size_t dstPitch)
+{
+	const std::size_t blockSize = format == ENFSTextureFormat::BC1 ? 8 : 16;
+	for (std::size_t i = 0; i < blocksCount; i++) {
+		DecodeBlockScalar(format, blocks + i * blockSize, dst + i * 16, dstPitch);
+	}
+}
+
+#if BB_X86
+// Shuffle masks to expand one byte of 2-bit color indices into 4 RGBA8 pixels
+struct ColorShuffleTable
+{
+	alignas(16) std::uint8_t Masks[256][16];
+
+	ColorShuffleTable()
+	{
+		for (std::uint32_t indices = 0; indices < 256; indices++) {
+			for (std::uint32_t x = 0; x < 4; x++) {
+				const std::uint32_t colorIndex = (indices >> (x * 2)) & 3;
+				for (std::uint32_t channel = 0; channel < 4; channel++) {
+					Masks[indices][x * 4 + channel] = static_cast<std::uint8_t>(colorIndex * 4 + channel);
+				}
+			}
+		}
+	}
+};
+
+static const ColorShuffleTable ColorShuffles;
+
+BB_TARGET_SSSE3 static inline __m128i
+DecodeColorPaletteSSSE3(const std::uint8_t* block, bool onlyOpaque)
+{
+	const std::uint16_t c0 = ReadShort(block);
+	const std::uint16_t c1 = ReadShort(block + 2);
+
+	// [r0 g0 b0 a0 r1 g1 b1 a1] in 16-bit lanes
+	const __m128i packedEndpoints = _mm_setr_epi16(
+		(c0 >> 11) & 0x1F, (c0 >> 5) & 0x3F, c0 & 0x1F, 0,
+		(c1 >> 11) & 0x1F, (c1 >> 5) & 0x3F, c1 & 0x1F, 0
+	);
+	const __m128i expandFactors = _mm_setr_epi16(527, 259, 527, 0, 527, 259, 527, 0);
+	const __m128i expandBias = _mm_setr_epi16(23, 33, 23, 0xFF << 6, 23, 33, 23, 0xFF << 6);
+	const __m128i endpoints = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(packedEndpoints, expandFactors), expandBias), 6);
+	const __m128i swappedEndpoints = _mm_shuffle_epi32(endpoints, _MM_SHUFFLE(1, 0, 3, 2));
+
+	__m128i interpolated;
+	if (c0 > c1 || onlyOpaque) {
+		// (2 * c0 + c1 + 1) / 3 and (c0 + 2 * c1 + 1) / 3, division by multiplication with 2^17 / 3
+		const __m128i sums = _mm_add_epi16(_mm_add_epi16(endpoints, endpoints), _mm_add_epi16(swappedEndpoints, _mm_set1_epi16(1)));
+		interpolated = _mm_srli_epi16(_mm_mulhi_epu16(sums, _mm_set1_epi16(static_cast<short>(0xAAAB))), 1);
+	} else {
+		interpolated = _mm_avg_epu16(endpoints, swappedEndpoints);
+		interpolated = _mm_and_si128(interpolated, _mm_setr_epi16(-1, -1, -1, -1, 0, 0, 0, 0));
+	}
+
+	return _mm_packus_epi16(endpoints, interpolated);
+}
+
+BB_TARGET_SSSE3 static inline __m128i
+DecodeAlphaSSSE3(ENFSTextureFormat format, const std::uint8_t* block)
+{
+	if (format == ENFSTextureFormat::BC2) {
+		// 4-bit alpha, every byte has two pixels
+		const __m128i packedAlpha = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+		const __m128i lowMask = _mm_set1_epi8(0x0F);
+		const __m128i lowNibbles = _mm_and_si128(packedAlpha, lowMask);
+		const __m128i highNibbles = _mm_and_si128(_mm_srli_epi16(packedAlpha, 4), lowMask);
+		const __m128i nibbles = _mm_unpacklo_epi8(lowNibbles, highNibbles);
+		return _mm_or_si128(_mm_slli_epi16(nibbles, 4), nibbles);
+	}
+
+	const std::uint16_t alpha0 = block[0];
+	const std::uint16_t alpha1 = block[1];
+	__m128i palette;
+	if (alpha0 > alpha1) {
+		const __m128i weights0 = _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1);
+		const __m128i weights1 = _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6);
+		const __m128i sums = _mm_add_epi16(
+			_mm_add_epi16(_mm_mullo_epi16(weights0, _mm_set1_epi16(alpha0)), _mm_mullo_epi16(weights1, _mm_set1_epi16(alpha1))),
+			_mm_set1_epi16(3)
+		);
+
+		// Division by 7 with multiplication by 2^16 / 7 (exact for sums below 13107)
+		palette = _mm_mulhi_epu16(sums, _mm_set1_epi16(9363));
+	} else {
+		const __m128i weights0 = _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0);
+		const __m128i weights1 = _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0);
+		const __m128i sums = _mm_add_epi16(
+			_mm_add_epi16(_mm_mullo_epi16(weights0, _mm_set1_epi16(alpha0)), _mm_mullo_epi16(weights1, _mm_set1_epi16(alpha1))),
+			_mm_set1_epi16(2)
+		);
+
+		palette = _mm_mulhi_epu16(sums, _mm_set1_epi16(13108));
+		palette = _mm_or_si128(_mm_and_si128(palette, _mm_setr_epi16(-1, -1, -1, -1, -1, -1, 0, 0)), _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 0xFF));
+	}
+
+	alignas(16) std::uint8_t indices[16];
+	std::uint64_t packedIndices = ReadAlphaIndices(block);
+	for (std::uint8_t& index : indices) {
+		index = static_cast<std::uint8_t>(packedIndices & 7);
+		packedIndices >>= 3;
+	}
+
+	return _mm_shuffle_epi8(_mm_packus_epi16(palette, palette), _mm_load_si128(reinterpret_cast<const __m128i*>(indices)));
+}
+
+// Returns 4 rows of 4 RGBA8 pixels
+BB_TARGET_SSSE3 static inline void
+DecodeBlockSSSE3(ENFSTextureFormat format, const std::uint8_t* block, __m128i rows[4])
+{
+	const std::uint8_t* colorBlock = format == ENFSTextureFormat::BC1 ? block : block + 8;
+	const __m128i palette = DecodeColorPaletteSSSE3(colorBlock, format != ENFSTextureFormat::BC1);
+	const std::uint32_t colorIndices = ReadLong(colorBlock + 4);
+	for (std::int32_t y = 0; y < 4; y++) {
+		const __m128i shuffleMask = _mm_load_si128(reinterpret_cast<const __m128i*>(ColorShuffles.Masks[(colorIndices >> (y * 8)) & 0xFF]));
+		rows[y] = _mm_shuffle_epi8(palette, shuffleMask);
+	}
+
+	if (format == ENFSTextureFormat::BC1) {
+		return;
+	}
+
+	// Moving alpha of pixels 4 * y ... 4 * y + 3 to the alpha channel of row y
+	const __m128i alpha = DecodeAlphaSSSE3(format, block);
+	const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+	for (std::int32_t y = 0; y < 4; y++) {
+		const char a = static_cast<char>(y * 4);
+		const __m128i alphaMask = _mm_setr_epi8(-1, -1, -1, a, -1, -1, -1, a + 1, -1, -1, -1, a + 2, -1, -1, -1, a + 3);
+		rows[y] = _mm_or_si128(_mm_and_si128(rows[y], colorMask), _mm_shuffle_epi8(alpha, alphaMask));
+	}
+}
+
+template<ENFSTextureFormat Format>
+BB_TARGET_SSSE3 static void
+DecodeBlocksRowSSSE3(const std::uint8_t* blocks, std::size_t blocksCount, std::uint8_t* dst, std::size_t dstPitch)
+{
+	constexpr std::size_t blockSize = Format == ENFSTextureFormat::BC1 ? 8 : 16;
+	for (std::size_t i = 0; i < blocksCount; i++) {
+		__m128i rows[4];
+		DecodeBlockSSSE3(Format, blocks + i * blockSize, rows);
+		for (std::int32_t y = 0; y < 4; y++) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + y * dstPitch + i * 16), rows[y]);
+		}
+	}
+}
+
+// Two neighbour blocks are decoded together and written with one 32 bytes store per pixel row
+template<ENFSTextureFormat Format>
+BB_TARGET_AVX2 static void
+DecodeBlocksRowAVX2(const std::uint8_t* blocks, std::size_t blocksCount, std::uint8_t* dst, std::size_t dstPitch)
+{
+	constexpr std::size_t blockSize = Format == ENFSTextureFormat::BC1 ? 8 : 16;
+	std::size_t i = 0;
+	for (; i + 2 <= blocksCount; i += 2) {
+		__m128i leftRows[4];
+		__m128i rightRows[4];
+		DecodeBlockSSSE3(Format, blocks + i * blockSize, leftRows);
+		DecodeBlockSSSE3(Format, blocks + (i + 1) * blockSize, rightRows);
+		for (std::int32_t y = 0; y < 4; y++) {
+			const __m256i rows = _mm256_inserti128_si256(_mm256_castsi128_si256(leftRows[y]), rightRows[y], 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + y * dstPitch + i * 16), rows);
+		}
+	}
+
+	if (i < blocksCount) {
+		DecodeBlocksRowSSSE3<Format>(blocks + i * blockSize, blocksCount - i, dst + i * 16, dstPitch);
+	}
+}
+
+using DecodeBlocksRowFunction = void(*)(const std::uint8_t* blocks, std::size_t blocksCount, std::uint8_t* dst, std::size_t dstPitch);
+
+template<ENFSTextureFormat Format>
+static DecodeBlocksRowFunction
+GetDecodeBlocksRowFunction()
+{
+	const CpuFeatures& cpuFeatures = GetCpuFeatures();
+	if (cpuFeatures.AVX2) {
+		return DecodeBlocksRowAVX2<Format>;
+	}
+
+	if (cpuFeatures.SSSE3) {
+		return DecodeBlocksRowSSSE3<Format>;
+	}
+
+	return nullptr;
+}
+#endif
+
+// BC4 indices of CTX1 palette entries: endpoints, 1/3 and 2/3 are going to 2/7 and 5/7
+static constexpr std::uint8_t CTX1ToBC4Indices[4] = { 0, 1, 3, 6 };
+static constexpr std::uint8_t CTX1ToBC4SwappedIndices[4] = { 1, 0, 6, 3 };
+
+void
+TranscodeCTX1BlocksToBC5(const char* blocks, std::size_t blocksCount, char* bc5Blocks)
+{
+	const std::uint8_t* srcBlock = reinterpret_cast<const std::uint8_t*>(blocks);
+	std::uint8_t* dstBlock = reinterpret_cast<std::uint8_t*>(bc5Blocks);
+	for (std::size_t i = 0; i < blocksCount; i++) {
+		const std::uint32_t indices = ReadLong(srcBlock + 4);
+
+		// BC5 keeps X and Y in two BC4 blocks with the same indices layout
+		for (std::int32_t channel = 0; channel < 2; channel++) {
+			const std::uint8_t endpoint0 = srcBlock[channel];
+			const std::uint8_t endpoint1 = srcBlock[2 + channel];
+			std::uint8_t* channelBlock = dstBlock + channel * 8;
+
+			// BC4 interpolates 8 values only if the first endpoint is greater
+			const bool isSwapped = endpoint0 < endpoint1;
+			const std::uint8_t* indicesMap = isSwapped ? CTX1ToBC4SwappedIndices : CTX1ToBC4Indices;
+			channelBlock[0] = isSwapped ? endpoint1 : endpoint0;
+			channelBlock[1] = isSwapped ? endpoint0 : endpoint1;
+
+			std::uint64_t channelIndices = 0;
+			if (endpoint0 != endpoint1) {
+				for (std::int32_t pixel = 0; pixel < 16; pixel++) {
+					channelIndices |= static_cast<std::uint64_t>(indicesMap[(indices >> (pixel * 2)) & 3]) << (pixel * 3);
+				}
+			}
+
+			std::memcpy(channelBlock + 2, &channelIndices, 6);
+		}
+
+		srcBlock += 8;
+		dstBlock += 16;
+	}
+}
+
+void
+DecodeDXT3ABlocksRow(const char* blocks, std::size_t blocksCount, char* dst, std::size_t dstPitch)
+{
+	const std::uint8_t* srcBlock = reinterpret_cast<const std::uint8_t*>(blocks);
+	for (std::size_t i = 0; i < blocksCount; i++) {
+		for (std::int32_t y = 0; y < 4; y++) {
+			const std::uint16_t values = ReadShort(srcBlock + y * 2);
+			std::uint8_t* pixel = reinterpret_cast<std::uint8_t*>(dst + y * dstPitch + i * 4);
+			for (std::int32_t x = 0; x < 4; x++) {
+				pixel[x] = static_cast<std::uint8_t>(((values >> (x * 4)) & 0x0F) * 17);
+			}
+		}
+
+		srcBlock += 8;
+	}
+}
+
+void
+DecodeBCBlocksRow(ENFSTextureFormat format, const char* blocks, std::size_t blocksCount, char* dst, std::size_t dstPitch)
+{
+	const std::uint8_t* srcBlocks = reinterpret_cast<const std::uint8_t*>(blocks);
+	std::uint8_t* dstPixels = reinterpret_cast<std::uint8_t*>(dst);
+
+#if BB_X86
+	static const DecodeBlocksRowFunction decodeFunctions[3] = {
+		GetDecodeBlocksRowFunction<ENFSTextureFormat::BC1>(),
+		GetDecodeBlocksRowFunction<ENFSTextureFormat::BC2>(),
+		GetDecodeBlocksRowFunction<ENFSTextureFormat::BC3>()
+	};
+
+	DecodeBlocksRowFunction decodeFunction = nullptr;
+	switch (format) {
+	case ENFSTextureFormat::BC1:
+		decodeFunction = decodeFunctions[0];
+		break;
+	case ENFSTextureFormat::BC2:
+		decodeFunction = decodeFunctions[1];
+		break;
+	case ENFSTextureFormat::BC3:
+		decodeFunction = decodeFunctions[2];
+		break;
+	default:
+		return;
+	}
+
+	if (decodeFunction != nullptr) {
+		decodeFunction(srcBlocks, blocksCount, dstPixels, dstPitch);
+		return;
+	}
+#endif
+
+	DecodeBlocksRowScalar(format, srcBlocks, blocksCount, dstPixels, dstPitch);
+}
+
+}
@@ -0,0 +1,35 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+// Decodes one row of BC1/BC2/BC3 blocks into 4 rows of RGBA8 pixels.
+// dstPitch - size of one pixel row in bytes (at least blocksCount * 16)
+void DecodeBCBlocksRow(ENFSTextureFormat format, const char* blocks, std::size_t blocksCount, char* dst, std::size_t dstPitch);
+
+// CTX1 block (two 8-bit XY endpoints and 2-bit indices) to BC5 block with the nearest interpolation weights
+void TranscodeCTX1BlocksToBC5(const char* blocks, std::size_t blocksCount, char* bc5Blocks);
+
+// DXT3A block (4-bit values) to 4 rows of R8 pixels
+void DecodeDXT3ABlocksRow(const char* blocks, std::size_t blocksCount, char* dst, std::size_t dstPitch);
+
+}
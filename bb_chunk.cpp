@@ -18,6 +18,9 @@
 * Boston, MA 02110-1301 USA
 *****************************************************************/
 #include "blackbox_pch.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace bb
 {
@@ -26,6 +29,19 @@ nfr::api::binary_hash_map<FrontendPackage> FEPackages;
 nfr::api::binary_hash_map<MaterialInfo> MaterialsMap;
 nfr::api::binary_hash_map<GameLight> LightsMap;
 std::vector<EngineLightPack> EngineLightsMap;
+nfr::api::binary_hash_map<TextureAnimationTable> TextureAnimationsMap;
+nfr::api::binary_hash_map<SceneryBVH> ScenerySectionsMap;
+nfr::api::binary_hash_map<SceneryGroupEntry> SceneryGroupsMap;
+nfr::api::binary_hash_map<TrackInfo> TracksMap;
+nfr::api::binary_hash_map<SolidListData> SolidListsMap;
+nfr::api::binary_hash_map<OptimizedSolid> OptimizedSolidsMap;
+ETextureOutputMode TextureOutputMode = ETextureOutputMode::Files;
+bool GenerateMissingMipLevels = true;
+bool PackUITextureAtlases = false;
+bool OptimizeMeshes = false;
+
+// File which is loaded now, streamed textures are read from it if the pack header names no other file
+static nfr::api::path LoadingFilePath;
 
 void 
 JLZDecompress(std::uint8_t* input, std::uint8_t* output, std::int32_t inputLength, std::int32_t outputLength)
@@ -71,19 +87,62 @@ JLZDecompress(std::uint8_t* input, std::uint8_t* output, std::int32_t inputLengt
 }
 
 void 
-ProcessTextureLoadAnimationChunk(aChunk* anumChunk)
-{
-	aChunk* nextChunk = anumChunk + 1;
-	aChunk* lastChunk = (aChunk*)((char*)anumChunk + anumChunk->Size + 8);
-	while (nextChunk != lastChunk) {
-		dbg::Verbose("Processing anim chunk...");
-		if (nextChunk->Id != static_cast<std::uint32_t>(ENFSChunkId::TPK_AnimBlock)) {
-			dbg::Warning("Unexpected chunkId {:#06x} in texture animation chunk. Skipping this one...", nextChunk->Id);
-			nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + 8);
+ProcessTextureLoadAnimationChunk(aChunk* animChunk, TextureAnimationTable& animationTable)
+{
+	ChunkProfileScope profileScope(animChunk);
+	dbg::Verbose("Processing anim chunk...");
+	for (aChunk& childChunk : animChunk->getChildren()) {
+		if (childChunk.Id != static_cast<std::uint32_t>(ENFSChunkId::TPK_AnimBlock)) {
+			dbg::Warning("Unexpected chunkId {:#06x} in texture animation chunk. Skipping this one...", childChunk.Id);
 			continue;
 		}
 
-		nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + 8);
+		// Every animation header is followed by the table of its frames
+		TextureAnim* textureAnim = nullptr;
+		bool bEndianSwapped = false;
+		for (aChunk& animPartChunk : childChunk.getChildren()) {
+			switch (static_cast<ENFSChunkId>(animPartChunk.Id)) {
+			case ENFSChunkId::TPK_AnimPart1: {
+				if (animPartChunk.getSize() < sizeof(TextureAnim)) {
+					textureAnim = nullptr;
+					continue;
+				}
+
+				textureAnim = animPartChunk.getDataPtr<TextureAnim>();
+				bEndianSwapped = !!textureAnim->EndianSwapped;
+				if (bEndianSwapped) {
+					EndianSwap(*textureAnim);
+					textureAnim->EndianSwapped = 0;
+				}
+			}
+			break;
+
+			case ENFSChunkId::TPK_AnimPart2: {
+				if (textureAnim == nullptr) {
+					dbg::Warning("Texture animation frames without header. Skipping this one...");
+					continue;
+				}
+
+				TextureAnimEntry* animEntries = animPartChunk.getDataPtr<TextureAnimEntry>();
+				const std::size_t animEntriesCount = animPartChunk.getSize() / sizeof(TextureAnimEntry);
+				if (bEndianSwapped) {
+					EndianSwapArray(animEntries, animEntriesCount);
+				}
+
+				if (!animationTable.addAnimation(*textureAnim, animEntries, animEntriesCount)) {
+					dbg::Warning("Invalid texture animation {:#06x} ({} frames, {} in table). Skipping this one...", textureAnim->NameHash, textureAnim->NumFrames, animEntriesCount);
+				} else {
+					dbg::Verbose("        Found texture animation \"{}\" ({} frames, {} fps)", std::string_view(textureAnim->Name, strnlen(textureAnim->Name, sizeof(textureAnim->Name))), textureAnim->NumFrames, textureAnim->FramesPerSecond);
+				}
+
+				textureAnim = nullptr;
+			}
+			break;
+
+			default:
+				break;
+			}
+		}
 	}
 }
 
@@ -91,14 +150,14 @@ bool
 ProcessTexturePackHeaderChunk(
 	aChunk* chunkData,
 	TexturePackHeader& outHeader, 
-	TexturePlatInfo& outPlatInfo,
+	std::vector<TexturePlatInfo>& texturesPlatInfo,
+	std::vector<StreamingEntry>& streamingEntries,
 	std::vector<TextureInfo>& texturesInfo
 )
 {
+	ChunkProfileScope profileScope(chunkData);
 	static const char verifyBuffer[12] = {};
 	nfr::api::binary_hash_set hashesStorage;
-	aChunk* nextChunk = chunkData + 1;
-	aChunk* lastChunk = (aChunk*)((char*)chunkData + chunkData->Size + 8);
 
 	TextureInfo* textureInfo = nullptr;
 	aChunk* animChunk = nullptr;
@@ -107,23 +166,34 @@ ProcessTexturePackHeaderChunk(
 	std::uint32_t texturesInfoCount = 0;
 	bool bEndianSwapped = false;
 
-	while (nextChunk != lastChunk) {
-		const char* chunkName = (NfsChunkIdMap.find(nextChunk->Id) != NfsChunkIdMap.end() ? NfsChunkIdMap.at(nextChunk->Id).data() : "");
-		dbg::Verbose("    Processing chunk {}...", chunkName);
+	for (aChunk& childChunk : chunkData->getChildren()) {
+		if (dbg::IsVerboseEnabled()) {
+			dbg::Verbose("    Processing chunk {}...", GetNFSChunkName(childChunk.Id));
+		}
 
-		switch (static_cast<ENFSChunkId>(nextChunk->Id)) {
+		switch (static_cast<ENFSChunkId>(childChunk.Id)) {
 		case ENFSChunkId::TPK_InfoPart1: {
-			TexturePackHeader* texturePackHeader = (TexturePackHeader*)(nextChunk + 1);
+			TexturePackHeader* texturePackHeader = childChunk.getDataPtr<TexturePackHeader>();
+			bEndianSwapped = !!texturePackHeader->EndianSwapped;
+			if (bEndianSwapped) {
+				EndianSwap(*texturePackHeader);
+				texturePackHeader->EndianSwapped = 0;
+			}
+
 			std::memcpy(&outHeader, texturePackHeader, sizeof(TexturePackHeader));
 			dbg::Verbose("        Found package name {:#06x} ({})", texturePackHeader->FilenameHash, texturePackHeader->Name);
 		}
 		break;
 
 		case ENFSChunkId::TPK_InfoPart2: {
-			TextureIndexEntry* textureIndexEntry = (TextureIndexEntry*)(nextChunk + 1);
-			textureIndexesCount = (nextChunk->Size / sizeof(TextureIndexEntry));
+			TextureIndexEntry* textureIndexEntry = childChunk.getDataPtr<TextureIndexEntry>();
+			textureIndexesCount = (childChunk.Size / sizeof(TextureIndexEntry));
+			if (bEndianSwapped) {
+				EndianSwapArray(textureIndexEntry, textureIndexesCount);
+			}
+
 			for (std::uint32_t i = 0; i < textureIndexesCount; i++) {
-				dbg::Verbose("        Found entry hash {:#06x} (padding: {})", textureIndexEntry->NameHash, textureIndexEntry->Padding);
+				dbg::Trace(ETraceEvent::TexturePackEntry, textureIndexEntry->NameHash, textureIndexEntry->Padding);
 				hashesStorage.insert(textureIndexEntry->NameHash);
 				textureIndexEntry++;
 			}
@@ -132,50 +202,83 @@ ProcessTexturePackHeaderChunk(
 		break;
 
 		case ENFSChunkId::TPK_InfoPart3: {
-			StreamingEntry* streamingEntry = (StreamingEntry*)(nextChunk + 1);
-			for (std::uint32_t i = 0; i < (nextChunk->Size / sizeof(StreamingEntry)); i++) {
-				dbg::Verbose("        Found streaming entry {:#06x}", streamingEntry->NameHash);
+			StreamingEntry* streamingEntry = childChunk.getDataPtr<StreamingEntry>();
+			const std::uint32_t streamingEntriesCount = childChunk.Size / sizeof(StreamingEntry);
+			if (bEndianSwapped) {
+				EndianSwapArray(streamingEntry, streamingEntriesCount);
+			}
+
+			streamingEntries.assign(streamingEntry, streamingEntry + streamingEntriesCount);
+			for (std::uint32_t i = 0; i < streamingEntriesCount; i++) {
+				dbg::Trace(ETraceEvent::TextureStreamEntry, streamingEntry->NameHash);
 				streamingEntry++;
 			}
 		}
 		break;
 
 		case ENFSChunkId::TPK_InfoPart4: {
-			textureInfo = (TextureInfo*)(nextChunk + 1);;
+			// Entries are packed, every one ends with the debug name of its own size
+			constexpr std::size_t TextureInfoFixedSize = offsetof(TextureInfo, DebugName);
+			textureInfo = childChunk.getDataPtr<TextureInfo>();
+			std::size_t bytesLeft = childChunk.getSize();
 			texturesInfo.reserve(textureIndexesCount);
 			for (std::uint32_t i = 0; i < textureIndexesCount; i++) {
+				if (bytesLeft < TextureInfoFixedSize) {
+					dbg::Warning("Texture info {} is out of chunk bounds. Couldn't process this chunk anymore", i);
+					break;
+				}
+
 				if (std::memcmp(textureInfo->BigPadding, verifyBuffer, sizeof(verifyBuffer)) != 0) {
 					dbg::Warning("Something wrong with BigPadding!!! Couldn't process this chunk anymore (i - {})", i);
 					break;
 				}
 
-				dbg::Verbose("        Found texture info {:#06x} ({})", textureInfo->NameHash, textureInfo->DebugName);
-				texturesInfo.emplace_back(*textureInfo);
-				textureInfo = (TextureInfo*)((char*)textureInfo + textureInfo->DebugNameSize + 89);
+				const std::size_t entrySize = TextureInfoFixedSize + static_cast<std::uint8_t>(textureInfo->DebugNameSize);
+				if (entrySize > bytesLeft || entrySize > sizeof(TextureInfo)) {
+					dbg::Warning("Texture info {} is out of chunk bounds. Couldn't process this chunk anymore", i);
+					break;
+				}
+
+				if (bEndianSwapped) {
+					EndianSwap(*textureInfo);
+				}
+
+				TextureInfo& textureInfoCopy = texturesInfo.emplace_back();
+				std::memset(&textureInfoCopy, 0, sizeof(TextureInfo));
+				std::memcpy(&textureInfoCopy, textureInfo, entrySize);
+				textureInfoCopy.DebugName[sizeof(textureInfoCopy.DebugName) - 1] = '\0';
+				dbg::TraceNamed(ETraceEvent::TextureInfoEntry, textureInfoCopy.DebugName, textureInfoCopy.NameHash);
+
+				textureInfo = (TextureInfo*)((char*)textureInfo + entrySize);
+				bytesLeft -= entrySize;
 			}
 		}
 		break;
 
 		case ENFSChunkId::TPK_InfoPart5: {
-			TexturePlatInfo* texturePlatInfoEntry = (TexturePlatInfo*)(nextChunk + 1);
-			std::memcpy(&outPlatInfo, texturePlatInfoEntry, sizeof(TexturePlatInfo));
+			// One entry for every texture in the same order as textures info
+			TexturePlatInfo* texturePlatInfoEntry = childChunk.getDataPtr<TexturePlatInfo>();
+			texturesInfoCount = childChunk.Size / sizeof(TexturePlatInfo);
+			if (bEndianSwapped) {
+				EndianSwapArray(texturePlatInfoEntry, texturesInfoCount);
+			}
 
-			const std::string_view& formatName = (TexturesFormatMap.find(texturePlatInfoEntry->format) != TexturesFormatMap.end() ? TexturesFormatMap.at(texturePlatInfoEntry->format) : "");
-			dbg::Verbose("        Found texture plat info (format: {})", formatName);
-			texturesInfoCount = nextChunk->Size / 32 /* #TODO: check this one */;
+			texturesPlatInfo.assign(texturePlatInfoEntry, texturePlatInfoEntry + texturesInfoCount);
+			if (dbg::IsVerboseEnabled() && texturesInfoCount != 0) {
+				const std::string_view& formatName = (TexturesFormatMap.find(texturePlatInfoEntry->format) != TexturesFormatMap.end() ? TexturesFormatMap.at(texturePlatInfoEntry->format) : "");
+				dbg::Verbose("        Found texture plat info (format: {})", formatName);
+			}
 		}
 		break;
 
 		case ENFSChunkId::TPK_BinData: {
-			animChunk = nextChunk;
+			animChunk = &childChunk;
 		}
 		break;
 
 		default:
 			break;
 		}
-
-		nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + 8);
 	}
 
 	if (textureIndexesCount != texturesInfoCount) {
@@ -183,7 +286,11 @@ ProcessTexturePackHeaderChunk(
 	}
 
 	if (animChunk != nullptr) {
-		ProcessTextureLoadAnimationChunk(animChunk);
+		TextureAnimationTable animationTable;
+		ProcessTextureLoadAnimationChunk(animChunk, animationTable);
+		if (!animationTable.empty()) {
+			TextureAnimationsMap[outHeader.FilenameHash] = std::move(animationTable);
+		}
 	}
 
 	return true;
@@ -199,8 +306,7 @@ ProcessTexturePackDataChunk(aChunk* chunkData)
 	int32_t* someBlockSize = (int32_t*)((char*)&nextNextChunk->Size + nextChunk->Size);
 	aChunk* dataChunk = (aChunk*)((((char*)nextChunk + nextChunk->Size) + *someBlockSize) + 16);
 	if (!!vramHeader->EndianSwapped) {
-		vramHeader->Version = BYTESWAP_LONG(vramHeader->Version);
-		vramHeader->FilenameHash = BYTESWAP_LONG(vramHeader->FilenameHash);
+		EndianSwap(*vramHeader);
 		vramHeader->EndianSwapped = 0;
 	}
 
@@ -208,6 +314,156 @@ ProcessTexturePackDataChunk(aChunk* chunkData)
 	return dataChunk;
 }
 
+static ENFSTextureFormat
+GetTextureFormat(const TextureInfo& textureInfo, std::uint32_t platFormat)
+{
+	// Platform format is more precise (DXN, CTX1 and others have no compression type)
+	ENFSTextureFormat texFormat = GetNFSFormatFromFCC(platFormat);
+	if (texFormat == ENFSTextureFormat::Unknown) {
+		texFormat = GetNFSFormatFromCompressionType(textureInfo.ImageCompressionType);
+	}
+
+	return texFormat;
+}
+
+static const char*
+GetTextureName(const TextureInfo& textureInfo)
+{
+	auto entryIt = EntriesMap.find(textureInfo.NameHash);
+	return entryIt != EntriesMap.end() ? entryIt->second.c_str() : textureInfo.DebugName;
+}
+
+// Files left by an interrupted conversion have a broken header or miss some levels, they are converted again
+static bool
+IsConvertedTextureValid(const nfr::api::path& filePath)
+{
+	if (!TextureConverter::OutputFileExists(filePath)) {
+		return false;
+	}
+
+	MappedFile mappedFile;
+	DDSTextureView textureView;
+	if (!TextureConverter::MapDDSFile(filePath, mappedFile, textureView)) {
+		return false;
+	}
+
+	const TextureLevelView& lastLevel = textureView.Levels.back();
+	return lastLevel.Data + lastLevel.Size == mappedFile.getData() + mappedFile.getSize();
+}
+
+static bool
+ProcessTexture(
+	const TextureInfo& textureInfo,
+	ENFSTextureFormat texFormat,
+	std::uint64_t sourceHash,
+	const char* dataPtr,
+	bool isXenonPlatform,
+	TextureArchiveWriter* archiveWriter,
+	TextureAtlasBuilder* atlasBuilder
+)
+{
+	// Scratch buffers are reused by all textures converted on this thread
+	thread_local std::vector<char> pcData;
+	thread_local std::vector<char> transcodedData;
+    
+	const char* texturePackedData = (dataPtr + textureInfo.ImagePlacement);
+
+	const char* textureName = GetTextureName(textureInfo);
+    
+    if (texFormat == ENFSTextureFormat::Unknown) {
+        dbg::Warning("Unknown texture format {} in texture {}. Skipping texture...", textureInfo.ImageCompressionType, textureName);
+        return true;
+    }
+
+	dbg::TraceNamed(ETraceEvent::TextureLoad,
+		textureName,
+		textureInfo.NameHash,
+		textureInfo.Width,
+		textureInfo.Height,
+		textureInfo.ImageSize,
+		textureInfo.NumMipMapLevels,
+		texFormat
+	);
+
+	nfr::api::path outFileDDSPath = EngineFactory->getResourcesDirectory();
+	outFileDDSPath.append("textures");
+
+	std::string ddsFileName = textureName;
+	ddsFileName += ".dds";
+	outFileDDSPath.append(ddsFileName);
+	const std::uint32_t ddsFileHash = nfr::api::getBinaryUpperHash(ddsFileName.c_str());
+
+	// Small textures of UI packs are converted every time, they go to the atlas instead of the file
+	const bool bPackToAtlas = atlasBuilder != nullptr && TextureAtlasBuilder::CanBePacked(textureInfo.Width, textureInfo.Height);
+
+	// The file is checked too, so removed or broken textures are converted again
+	if (archiveWriter == nullptr && !bPackToAtlas && TextureConversionCache::IsUpToDate(LooseFilesOutputHash, ddsFileHash, sourceHash) && IsConvertedTextureValid(outFileDDSPath)) {
+		TextureConversionCache::CountSkipped(1);
+		return true;
+	}
+	
+	const char* pcDataPtr = texturePackedData;
+	std::size_t pcDataSize = textureInfo.ImageSize;
+	std::int32_t mipLevels = TextureConverter::GetMipLevelsCount(texFormat, textureInfo.Width, textureInfo.Height, textureInfo.NumMipMapLevels, textureInfo.ImageSize);
+
+	if (isXenonPlatform) {
+		if (!TextureConverter::UntileXenonTexture(textureInfo.Width, textureInfo.Height, textureInfo.NumMipMapLevels, GetTextureBlockSize(texFormat), GetTextureBlockDimension(texFormat), texturePackedData, textureInfo.ImageSize, true, pcData, mipLevels)) {
+			dbg::Warning("Couldn't convert {} texture from Xenon to PC format.", textureInfo.DebugName);
+			return false;
+		}
+
+		pcDataPtr = pcData.data();
+		pcDataSize = pcData.size();
+	}
+
+	if (GetTranscodedFormat(texFormat) != texFormat) {
+		const ENFSTextureFormat xenonFormat = texFormat;
+		if (!TextureConverter::TranscodeTexture(textureInfo.Width, textureInfo.Height, mipLevels, xenonFormat, pcDataPtr, pcDataSize, transcodedData, texFormat)) {
+			dbg::Warning("Couldn't transcode {} texture from {} format.", textureName, GetNFSFormatString(xenonFormat));
+			return false;
+		}
+
+		pcDataPtr = transcodedData.data();
+		pcDataSize = transcodedData.size();
+	}
+
+	if (bPackToAtlas) {
+		thread_local std::vector<char> decodedData;
+		ENFSTextureFormat decodedFormat = texFormat;
+		const char* rgbaData = pcDataPtr;
+		if (texFormat != ENFSTextureFormat::RGBA8) {
+			if (!TextureConverter::DecodeTexture(textureInfo.Width, textureInfo.Height, GetTextureBlockSize(texFormat), texFormat, pcDataPtr, pcDataSize, decodedData, decodedFormat)) {
+				return false;
+			}
+
+			rgbaData = decodedData.data();
+		}
+
+		// Formats which can't be decoded are written as usual
+		if (decodedFormat == ENFSTextureFormat::RGBA8) {
+			atlasBuilder->addTexture(textureInfo.NameHash, textureInfo.Width, textureInfo.Height, rgbaData);
+			return true;
+		}
+	}
+
+	if (archiveWriter != nullptr) {
+		return archiveWriter->addTexture(textureInfo.NameHash, texFormat, textureInfo.Width, textureInfo.Height, mipLevels, pcDataPtr, pcDataSize);
+	}
+    
+	nfr::api::SafeInterface<nfr::api::IStream> ddsStream = TextureConverter::CreateOutputFile(outFileDDSPath);
+	if (!ddsStream->isOpen()) {
+		dbg::Warning("Couldn't create raw file {}.", ddsFileName);
+		return false;
+	}
+    
+    if (!TextureConverter::EncodeTextureToFile(textureInfo.Width, textureInfo.Height, mipLevels, texFormat, texFormat, pcDataPtr, pcDataSize, ddsStream.get())) {
+        return false;
+    }
+
+	TextureConversionCache::Update(LooseFilesOutputHash, ddsFileHash, sourceHash);
+	return true;
+}
+
 bool
 ProcessTexturePackChunk(aChunk* chunkData)
 {	
@@ -217,20 +473,19 @@ ProcessTexturePackChunk(aChunk* chunkData)
 	aChunk* dataChunk = nullptr; 
 	std::vector<TextureInfo> texturesInfo;
 	TexturePackHeader texturePackHeader = {};
-	TexturePlatInfo texturePlatInfo = {};
+	std::vector<TexturePlatInfo> texturesPlatInfo;
+	std::vector<StreamingEntry> streamingEntries;
 
 	if (chunkId == ENFSChunkId::TPK_Blocks) {
-		aChunk* nextChunk = chunkData + 1;
-		aChunk* lastChunk = (aChunk*)((char*)chunkData + chunkData->Size + 8);
-		while (nextChunk != lastChunk) {
-			ENFSChunkId nextChunkId = static_cast<ENFSChunkId>(nextChunk->Id);
-			if (nextChunkId == ENFSChunkId::TPK_InfoBlock) {
-				ProcessTexturePackHeaderChunk(nextChunk, texturePackHeader, texturePlatInfo, texturesInfo);
-			} else if (nextChunkId == ENFSChunkId::TPK_DataBlock) {
-				dataChunk = ProcessTexturePackDataChunk(nextChunk);
+		for (aChunk& childChunk : chunkData->getChildren()) {
+			ENFSChunkId childChunkId = static_cast<ENFSChunkId>(childChunk.Id);
+			if (childChunkId == ENFSChunkId::TPK_InfoBlock) {
+				ProcessTexturePackHeaderChunk(&childChunk, texturePackHeader, texturesPlatInfo, streamingEntries, texturesInfo);
+			} else if (childChunkId == ENFSChunkId::TPK_DataBlock) {
+				// Top-level data blocks are already measured by ProcessChunk
+				ChunkProfileScope profileScope(&childChunk);
+				dataChunk = ProcessTexturePackDataChunk(&childChunk);
 			}
-
-			nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + sizeof(aChunk));
 		}
 	} else if (chunkId == ENFSChunkId::TPK_DataBlock) {
 		dataChunk = ProcessTexturePackDataChunk(chunkData);
@@ -246,6 +501,21 @@ ProcessTexturePackChunk(aChunk* chunkData)
 		return false;
 	}
 
+	// Streamed packs have no data chunk, textures are loaded from the file on request
+	if (dataChunk == nullptr && !streamingEntries.empty()) {
+		std::vector<ENFSTextureFormat> texturesFormat(texturesInfo.size());
+		for (std::size_t i = 0; i < texturesInfo.size(); i++) {
+			texturesFormat[i] = GetTextureFormat(texturesInfo[i], i < texturesPlatInfo.size() ? texturesPlatInfo[i].format : 0);
+		}
+
+		return TextureStreamer::RegisterPack(LoadingFilePath, texturePackHeader, streamingEntries, texturesInfo, texturesFormat, isXenonPlatform);
+	}
+
+	if (dataChunk == nullptr) {
+		dbg::Warning("No textures data was found in chunk {}. Skipping the chunk", texturePackHeader.Filename);
+		return false;
+	}
+
 	char* dataPtr = dataChunk->getDataPtr();	// Textures chunk is aligned by 4096 bytes
 	std::size_t alignedSize = dataChunk->getSize();
 
@@ -256,94 +526,213 @@ ProcessTexturePackChunk(aChunk* chunkData)
 	}
 
 	dbg::Verbose("    Processing textures in TPK block...");
-	for (int32_t i = 0; i < texturesInfo.size(); i++) {
-		const TextureInfo& textureInfo = texturesInfo[i];
-		ENFSTextureFormat texFormat = GetNFSFormatFromCompressionType(textureInfo.ImageCompressionType);
-        
-		const char* texturePackedData = (dataPtr + textureInfo.ImagePlacement);
-		const std::size_t blockSize = texFormat == ENFSTextureFormat::BC1 ? 8 : 16;
 
-		const char* textureName = textureInfo.DebugName;
-		if (EntriesMap.find(textureInfo.NameHash) != EntriesMap.end()) {
-			textureName = EntriesMap.at(textureInfo.NameHash).c_str();
-		}
-        
-        if (texFormat == ENFSTextureFormat::Unknown) {
-            dbg::Warning("Unknown texture format {} in texture {}. Skipping texture...", textureInfo.ImageCompressionType, textureName);
-            continue;
-        }
-
-		dbg::Verbose("        Loading {} ({}x{}, {}KB, {} mips, {} format)... ",
-			textureName,
+	// Source hashes are used to find duplicates and to skip textures which weren't changed since the last run
+	std::vector<ENFSTextureFormat> texturesFormat(texturesInfo.size());
+	std::vector<std::uint64_t> sourceHashes(texturesInfo.size());
+	ThreadPool::ParallelFor(texturesInfo.size(), [&](std::size_t i) {
+		const TextureInfo& textureInfo = texturesInfo[i];
+		texturesFormat[i] = GetTextureFormat(textureInfo, i < texturesPlatInfo.size() ? texturesPlatInfo[i].format : 0);
+		sourceHashes[i] = TextureDeduplicator::HashTexture(
+			texturesFormat[i],
 			textureInfo.Width,
 			textureInfo.Height,
-			textureInfo.ImageSize / 1024,
 			textureInfo.NumMipMapLevels,
-			GetNFSFormatString(texFormat)
+			dataPtr + textureInfo.ImagePlacement,
+			textureInfo.ImageSize
 		);
-		
-		std::vector<char> pcData;
-		const char* pcDataPtr = texturePackedData;
+	});
+
+	std::unique_ptr<TextureArchiveWriter> archiveWriter;
+	if (TextureOutputMode == ETextureOutputMode::Archive) {
+		nfr::api::path archivePath = EngineFactory->getResourcesDirectory();
+		archivePath.append("textures");
+		archivePath.append(std::to_string(texturePackHeader.FilenameHash) + ".bbta");
+
+		// The archive is written as a whole, so it's skipped only if none of its textures were changed
+		bool isPackUpToDate = EngineFactory->exists(archivePath);
+		for (std::size_t i = 0; i < texturesInfo.size() && isPackUpToDate; i++) {
+			isPackUpToDate = TextureConversionCache::IsUpToDate(texturePackHeader.FilenameHash, texturesInfo[i].NameHash, sourceHashes[i]);
+		}
 
-		if (isXenonPlatform) {
-			pcData.resize(textureInfo.ImageSize);
-			pcDataPtr = pcData.data();
+		if (isPackUpToDate) {
+			dbg::Verbose("    Texture pack {} wasn't changed. Skipping the pack...", texturePackHeader.Filename);
+			TextureConversionCache::CountSkipped(texturesInfo.size());
+			return true;
+		}
 
-			for (std::uint32_t i = 0; i < textureInfo.ImageSize; i += 2) {
-				std::uint16_t* ptrToSwap = (std::uint16_t*)&texturePackedData[i];
-				*ptrToSwap = BYTESWAP_SHORT(*ptrToSwap);
+		archiveWriter = std::make_unique<TextureArchiveWriter>(archivePath, texturePackHeader.FilenameHash, static_cast<std::uint32_t>(texturesInfo.size()));
+		if (!archiveWriter->isOpen()) {
+			return false;
+		}
+	}
+
+	std::unique_ptr<TextureAtlasBuilder> atlasBuilder;
+	if (PackUITextureAtlases && TextureAtlasBuilder::IsUITexturePack(texturePackHeader)) {
+		atlasBuilder = std::make_unique<TextureAtlasBuilder>();
+	}
+
+	// Textures with the same name would be written to the same file by different threads. Files were
+	// overwritten in order before, so only the last texture with the name is converted.
+	std::vector<bool> texturesSkipped(texturesInfo.size());
+	if (archiveWriter == nullptr) {
+		std::unordered_map<std::string_view, std::size_t> outputNames;
+		for (std::size_t i = 0; i < texturesInfo.size(); i++) {
+			auto [nameIt, bInserted] = outputNames.emplace(GetTextureName(texturesInfo[i]), i);
+			if (!bInserted) {
+				dbg::Warning("Texture {} is defined more than once in pack {}. Only the last one is converted.", nameIt->first, texturePackHeader.Filename);
+				texturesSkipped[nameIt->second] = true;
+				nameIt->second = i;
 			}
+		}
 
-			const char* mipDataPtr = texturePackedData;
-			char* mipPCDataPtr = pcData.data();
-			if (!TextureConverter::UntileXenonTexture(textureInfo.Width, textureInfo.Height, textureInfo.NumMipMapLevels, blockSize, mipDataPtr, mipPCDataPtr)) {
-				dbg::Warning("Couldn't convert {} texture from Xenon to PC format.", textureInfo.DebugName);
-				return false;
+		// Duplicates are found in texture order, so the same texture is the original on every run.
+		// Archives must contain all textures of their pack, so they are never deduplicated.
+		// Atlas members have no file which aliases could point to, so they are skipped too.
+		for (std::size_t i = 0; i < texturesInfo.size(); i++) {
+			if (texturesSkipped[i] || texturesFormat[i] == ENFSTextureFormat::Unknown) {
+				continue;
+			}
+
+			if (atlasBuilder != nullptr && TextureAtlasBuilder::CanBePacked(texturesInfo[i].Width, texturesInfo[i].Height)) {
+				continue;
+			}
+
+			std::uint32_t originalHash = 0;
+			if (!TextureDeduplicator::Register(texturesInfo[i].NameHash, sourceHashes[i], texturesInfo[i].ImageSize, originalHash)) {
+				dbg::Verbose("        Texture {} has the same content as {:#06x}. Skipping texture...", GetTextureName(texturesInfo[i]), originalHash);
+				texturesSkipped[i] = true;
 			}
 		}
-        
-		nfr::api::path outFileDDSPath = EngineFactory->getResourcesDirectory();
-		outFileDDSPath.append("textures");
+	}
 
-		std::string ddsFileName = textureName;
-		ddsFileName += ".dds";
-		outFileDDSPath.append(ddsFileName);
+	// Every texture has its own range in the data chunk, so they can be converted independently
+	std::vector<std::uint8_t> texturesFailed(texturesInfo.size());
+	ThreadPool::ParallelFor(texturesInfo.size(), [&](std::size_t i) {
+		if (texturesSkipped[i]) {
+			return;
+		}
 
-		if (EngineFactory->exists(outFileDDSPath)) {
-			std::filesystem::remove(outFileDDSPath);
+		if (!ProcessTexture(texturesInfo[i], texturesFormat[i], sourceHashes[i], dataPtr, isXenonPlatform, archiveWriter.get(), atlasBuilder.get())) {
+			texturesFailed[i] = 1;
 		}
+	});
 
-		nfr::api::SafeInterface<nfr::api::IStream> ddsStream = EngineFactory->openFile(nfr::api::EStreamFlags::WriteFlag, outFileDDSPath);
-		if (!ddsStream->isOpen()) {
-			dbg::Warning("Couldn't create raw file {}. Skipping the file...", ddsFileName);
+	bool bConversionFailed = false;
+	for (std::size_t i = 0; i < texturesInfo.size(); i++) {
+		if (texturesFailed[i] == 0) {
 			continue;
 		}
-        
-        if (!TextureConverter::EncodeTextureToFile(textureInfo.Width, textureInfo.Height, 1, texFormat, texFormat, pcDataPtr, textureInfo.ImageSize, ddsStream.get())) {
-            return false;
-        }
+
+		// Aliases must not point to the file which wasn't written
+		if (archiveWriter == nullptr) {
+			TextureDeduplicator::Unregister(texturesInfo[i].NameHash, sourceHashes[i]);
+		}
+
+		bConversionFailed = true;
 	}
 
-	return true;
+	if (atlasBuilder != nullptr && !atlasBuilder->write(texturePackHeader.FilenameHash)) {
+		bConversionFailed = true;
+	}
+
+	if (archiveWriter != nullptr) {
+		if (!archiveWriter->close()) {
+			return false;
+		}
+
+		if (!bConversionFailed) {
+			for (std::size_t i = 0; i < texturesInfo.size(); i++) {
+				TextureConversionCache::Update(texturePackHeader.FilenameHash, texturesInfo[i].NameHash, sourceHashes[i]);
+			}
+		}
+	}
+
+	return !bConversionFailed;
 }
 
 void 
-NotifyLoadSolidList(SolidListHeader* solidHeader)
+NotifyLoadSolidList(const SolidListView& solidList)
 {
+	std::size_t meshEntriesCount = 0;
+	std::size_t indicesCount = 0;
+	for (const SolidView& solid : solidList.Solids) {
+		meshEntriesCount += solid.MeshEntriesCount;
+		indicesCount += solid.IndicesCount;
+	}
 
+	dbg::Verbose("    Found solid list \"{}\" ({} solids, {} mesh entries, {} triangles)",
+		std::string_view(solidList.Header->Filename, strnlen(solidList.Header->Filename, sizeof(solidList.Header->Filename))),
+		solidList.Solids.size(),
+		meshEntriesCount,
+		indicesCount / 3
+	);
 }
 
 SolidListHeader* 
-ProcessSolidListHeaderChunk(aChunk* chunkData)
+ProcessSolidListHeaderChunk(aChunk* chunkData, SolidListView& solidList)
 {
+	ChunkProfileScope profileScope(chunkData);
 	SolidListHeader* foundHeader = nullptr;
+	bool bEndianSwapped = false;
+	for (aChunk& childChunk : chunkData->getChildren()) {
+		switch (static_cast<ENFSChunkId>(childChunk.Id)) {
+		case ENFSChunkId::SolidListInfo: {
+			if (childChunk.getSize() < sizeof(SolidListHeader)) {
+				continue;
+			}
+
+			foundHeader = childChunk.getDataPtr<SolidListHeader>();
+			bEndianSwapped = !!foundHeader->EndianSwapped;
+			if (bEndianSwapped) {
+				EndianSwap(*foundHeader);
+				foundHeader->EndianSwapped = 0;
+			}
+		}
+		break;
+
+		case ENFSChunkId::SolidListIndex: {
+			SolidIndexEntry* indexEntries = childChunk.getDataPtr<SolidIndexEntry>();
+			solidList.IndexEntriesCount = childChunk.getSize() / sizeof(SolidIndexEntry);
+			if (bEndianSwapped) {
+				EndianSwapArray(indexEntries, solidList.IndexEntriesCount);
+			}
+
+			solidList.IndexEntries = indexEntries;
+		}
+		break;
+
+		default:
+			break;
+		}
+	}
+
+	solidList.Header = foundHeader;
 	return foundHeader;
 }
 
-void 
-ProcessSolidListDataChunk(aChunk* chunkData, SolidListHeader* solidHeader)
+bool 
+ProcessSolidListDataChunks(const std::vector<aChunk*>& solidChunks, SolidListView& solidList)
 {
+	// Every solid lies in its own chunk, so they are parsed independently
+	std::vector<SolidView> solids(solidChunks.size());
+	std::vector<std::uint8_t> solidsParsed(solidChunks.size());
+	ThreadPool::ParallelFor(solidChunks.size(), [&](std::size_t i) {
+		solidsParsed[i] = ParseSolid(solidChunks[i], solids[i]);
+	});
+
+	solidList.Solids.reserve(solids.size());
+	for (std::size_t i = 0; i < solids.size(); i++) {
+		if (solidsParsed[i]) {
+			solidList.Solids.emplace_back(std::move(solids[i]));
+		}
+	}
+
+	if (solidList.Solids.size() != solidChunks.size()) {
+		dbg::Warning("    {} of {} solids couldn't be parsed.", solidChunks.size() - solidList.Solids.size(), solidChunks.size());
+	}
 
+	return !solidList.Solids.empty() || solidChunks.empty();
 }
 
 bool 
@@ -354,23 +743,45 @@ ProcessSolidListChunk(aChunk* chunkData)
 		return false;
 	}
 
-	aChunk* nextChunk = chunkData + 1;
-	aChunk* lastChunk = (aChunk*)((char*)chunkData + chunkData->Size + 8);
-	SolidListHeader* solidHeader = nullptr;
-	while (nextChunk != lastChunk) {
-		if (nextChunk->Id == static_cast<std::uint32_t>(ENFSChunkId::GeometryHeader)) {
-			if (solidHeader != nullptr) {
-				NotifyLoadSolidList(solidHeader);
-			}
-
-			solidHeader = ProcessSolidListHeaderChunk(nextChunk);
-		} else if (nextChunk->Id == static_cast<std::uint32_t>(ENFSChunkId::GeometryData)) {
-			ProcessSolidListDataChunk(nextChunk, solidHeader);
+	// Solids are parsed in place, so the copy is made before parsing
+	SolidListData solidListData;
+	const char* chunkBegin = reinterpret_cast<const char*>(chunkData);
+	solidListData.ChunkData.assign(chunkBegin, chunkBegin + sizeof(aChunk) + chunkData->getSize());
+	aChunk* ownChunk = reinterpret_cast<aChunk*>(solidListData.ChunkData.data());
+
+	SolidListView& solidList = solidListData.View;
+	std::vector<aChunk*> solidChunks;
+	for (aChunk& childChunk : ownChunk->getChildren()) {
+		if (childChunk.Id == static_cast<std::uint32_t>(ENFSChunkId::GeometryHeader)) {
+			ProcessSolidListHeaderChunk(&childChunk, solidList);
+		} else if (childChunk.Id == static_cast<std::uint32_t>(ENFSChunkId::GeometryData)) {
+			solidChunks.push_back(&childChunk);
 		}
+	}
+
+	if (solidList.Header == nullptr) {
+		dbg::Warning("No solid list header was found in geometry chunk. Skipping the chunk");
+		return false;
+	}
 
-		nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + sizeof(aChunk));
+	if (!ProcessSolidListDataChunks(solidChunks, solidList)) {
+		return false;
+	}
+
+	NotifyLoadSolidList(solidList);
+	if (OptimizeMeshes) {
+		std::vector<OptimizedSolid> optimizedSolids;
+		MeshOptimizationStats optimizationStats;
+		MeshOptimizer::OptimizeSolidList(solidList, optimizedSolids, optimizationStats);
+		MeshOptimizer::LogReport(optimizationStats);
+		for (OptimizedSolid& optimizedSolid : optimizedSolids) {
+			const std::uint32_t solidHash = optimizedSolid.NameHash;
+			OptimizedSolidsMap.insert_or_assign(solidHash, std::move(optimizedSolid));
+		}
 	}
 
+	const std::string solidListName(solidList.Header->Filename, strnlen(solidList.Header->Filename, sizeof(solidList.Header->Filename)));
+	SolidListsMap.insert_or_assign(nfr::api::getBinaryUpperHash(solidListName.c_str()), std::move(solidListData));
 	return true;
 }
 
@@ -382,7 +793,7 @@ ProcessFEFontChunk(aChunk* chunkData)
 	FontDescription fontDescription = {};
 	EngineFont* fontData = reinterpret_cast<EngineFont*>(chunkData->getDataPtr());
 	if (isXenonPlatform) {
-		fontData->Font.EndianSwap();
+		EndianSwap(fontData->Font);
 	}
 
 	fontDescription.Name = fontData->FontName;
@@ -472,9 +883,12 @@ ProcessFEPackageChunk(aChunk* chunkData)
 bool 
 ProcessQuickSplineChunk(aChunk* chunkData)
 {
-	aChunk* nextChunk = chunkData + 1;
-	aChunk* lastChunk = (aChunk*)((char*)chunkData + chunkData->Size + sizeof(aChunk));
-	QuickSpline* spline = reinterpret_cast<QuickSpline*>(nextChunk->getDataPtr() + 16);
+	aChunkIterator splineChunk = chunkData->getChildren().begin();
+	if (splineChunk == chunkData->getChildren().end() || splineChunk->getSize() < sizeof(QuickSpline) + 16) {
+		return false;
+	}
+
+	QuickSpline* spline = reinterpret_cast<QuickSpline*>(splineChunk->getDataPtr() + 16);
 
 	// #TODO: rework this shit
 	dbg::Verbose("    Found \"{}\" spline with {} size ({} -> {})",
@@ -484,10 +898,6 @@ ProcessQuickSplineChunk(aChunk* chunkData)
 		spline->MaxParam
 	);
 
-	while (nextChunk != lastChunk) {
-		nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + sizeof(aChunk));
-	}
-
 	return true;
 }
 
@@ -510,12 +920,17 @@ bool
 ProcessLightsChunk(aChunk* chunkData)
 {
 	EngineLightPack* engineLight = nullptr;
-	aChunk* nextChunk = chunkData + 1;
-	aChunk* lastChunk = (aChunk*)((char*)chunkData + chunkData->Size + sizeof(aChunk));
-	while (nextChunk != lastChunk) {
-		switch (static_cast<ENFSChunkId>(nextChunk->Id)) {
+	bool bEndianSwapped = false;
+	for (aChunk& childChunk : chunkData->getChildren()) {
+		switch (static_cast<ENFSChunkId>(childChunk.Id)) {
 			case ENFSChunkId::LightPack: {
-				LightPack* lightPack = nextChunk->getDataPtr<LightPack>();
+				LightPack* lightPack = childChunk.getDataPtr<LightPack>();
+				bEndianSwapped = !!lightPack->EndianSwapped;
+				if (bEndianSwapped) {
+					EndianSwap(*lightPack);
+					lightPack->EndianSwapped = 0;
+				}
+
 				if (GameVersion == EGameVersion::ProStreetXenon || GameVersion == EGameVersion::ProStreetPC) {
 					if (lightPack->Version != 4) {
 						dbg::Error("Invalid version of the light pack (in {}, required {})", lightPack->Version, 4);
@@ -530,7 +945,11 @@ ProcessLightsChunk(aChunk* chunkData)
 			}
 			break;
 			case ENFSChunkId::AABBTree: {
-				AABBTree* aabbTree = nextChunk->getDataPtr<AABBTree>();
+				AABBTree* aabbTree = childChunk.getDataPtr<AABBTree>();
+				if (bEndianSwapped) {
+					EndianSwap(*aabbTree);
+				}
+
 				if (engineLight == nullptr) {
 					dbg::Warning("    The engine light is empty. Skipping this chunk.");
 					continue;
@@ -544,7 +963,11 @@ ProcessLightsChunk(aChunk* chunkData)
 			}
 			break;
 			case ENFSChunkId::LightArray: {
-				GameLight* gameLight = nextChunk->getDataPtr<GameLight>();
+				GameLight* gameLight = childChunk.getDataPtr<GameLight>();
+				if (bEndianSwapped) {
+					EndianSwapArray(gameLight, childChunk.Size / sizeof(GameLight));
+				}
+
 				dbg::Verbose("    Found \"{}\" game light with hash {:#06x}", gameLight->Name, gameLight->NameHash);
 				LightsMap.emplace(std::move(std::make_pair(gameLight->NameHash, *gameLight)));
 			}
@@ -552,49 +975,221 @@ ProcessLightsChunk(aChunk* chunkData)
 		default:
 			break;
 		}
-		nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + sizeof(aChunk));
 	}
 
 	return true;
 }
 
 bool
-ProcessPCAWeightsChunk(aChunk* chunkData)
+ProcessSpeedSceneryChunk(aChunk* chunkData)
 {
-	ePcaWeights* weights = nullptr;
-	aChunk* nextChunk = chunkData + 1;
-	aChunk* lastChunk = (aChunk*)((char*)chunkData + chunkData->Size + sizeof(aChunk));
-	while (nextChunk != lastChunk) {
-		switch (static_cast<ENFSChunkId>(nextChunk->Id)) {
-		case ENFSChunkId::PCAWeightsData: {
-			weights = nextChunk->getDataPtr<ePcaWeights>();
-			if (EntriesMap.find(weights->NameHash) != EntriesMap.end()) {
-				dbg::Verbose("    Found PCA weights data \"{}\" with hash {:#06x}", EntriesMap.at(weights->NameHash), weights->NameHash);
-			} else {
-				dbg::Verbose("    Found PCA weights data with hash {:#06x}", weights->NameHash);
+	const bool isXenonPlatform = true;
+
+	ScenerySectionHeader* sectionHeader = nullptr;
+	SceneryInfo* sceneryInfos = nullptr;
+	SceneryInstance* sceneryInstances = nullptr;
+	std::size_t sceneryInfosCount = 0;
+	std::size_t sceneryInstancesCount = 0;
+	for (aChunk& childChunk : chunkData->getChildren()) {
+		const char* childData = nullptr;
+		std::size_t childSize = 0;
+		GetChunkData(childChunk, childData, childSize);
+
+		switch (static_cast<ENFSChunkId>(childChunk.Id)) {
+		case ENFSChunkId::ScenerySectionHeader: {
+			if (childSize < sizeof(ScenerySectionHeader)) {
+				continue;
+			}
+
+			sectionHeader = reinterpret_cast<ScenerySectionHeader*>(const_cast<char*>(childData));
+			if (isXenonPlatform) {
+				EndianSwap(*sectionHeader);
 			}
 		}
 		break;
-		case ENFSChunkId::PCAMeanData:
 
-			break;
-		case ENFSChunkId::PCAFramesData:
+		case ENFSChunkId::SceneryInfo: {
+			sceneryInfos = reinterpret_cast<SceneryInfo*>(const_cast<char*>(childData));
+			sceneryInfosCount = childSize / sizeof(SceneryInfo);
+			if (isXenonPlatform) {
+				EndianSwapArray(sceneryInfos, sceneryInfosCount);
+			}
+		}
+		break;
+
+		case ENFSChunkId::SceneryInstance: {
+			sceneryInstances = reinterpret_cast<SceneryInstance*>(const_cast<char*>(childData));
+			sceneryInstancesCount = childSize / sizeof(SceneryInstance);
+			if (sceneryInstancesCount > UINT16_MAX + 1) {
+				dbg::Warning("Scenery chunk has {} instances, only the first {} can be addressed by overrides. Truncating",
+					sceneryInstancesCount,
+					UINT16_MAX + 1
+				);
+				sceneryInstancesCount = UINT16_MAX + 1;
+			}
+
+			if (isXenonPlatform) {
+				EndianSwapArray(sceneryInstances, sceneryInstancesCount);
+			}
+		}
+		break;
 
-			break;
 		default:
 			break;
 		}
+	}
+
+	if (sectionHeader == nullptr) {
+		dbg::Warning("No scenery section header was found in scenery chunk. Skipping the chunk");
+		return false;
+	}
+
+	std::vector<SceneryInstanceEntry> instances;
+	instances.reserve(sceneryInstancesCount);
+	for (std::size_t i = 0; i < sceneryInstancesCount; i++) {
+		const SceneryInstance& sceneryInstance = sceneryInstances[i];
+		SceneryInstanceEntry& instance = instances.emplace_back();
+		std::memcpy(instance.BoundsMin, sceneryInstance.BBoxMin, sizeof(instance.BoundsMin));
+		std::memcpy(instance.BoundsMax, sceneryInstance.BBoxMax, sizeof(instance.BoundsMax));
+		std::memcpy(instance.Position, sceneryInstance.Position, sizeof(instance.Position));
+		instance.InstanceNumber = static_cast<std::uint16_t>(i);
+		instance.ExcludeFlags = sceneryInstance.ExcludeFlags;
+		instance.SolidNameHash = 0;
+		if (sceneryInstance.SceneryInfoNumber >= 0 && static_cast<std::size_t>(sceneryInstance.SceneryInfoNumber) < sceneryInfosCount) {
+			instance.SolidNameHash = sceneryInfos[sceneryInstance.SceneryInfoNumber].SolidMeshKey[0];
+		}
+	}
+
+	SceneryBVH sceneryBVH(sectionHeader->SectionNumber);
+	sceneryBVH.build(std::move(instances));
+	dbg::Verbose("    Found scenery section {} \"{}\" ({} scenery infos, {} instances, {} BVH nodes)",
+		sectionHeader->SectionNumber,
+		std::string_view(sectionHeader->DebugName, strnlen(sectionHeader->DebugName, sizeof(sectionHeader->DebugName))),
+		sceneryInfosCount,
+		sceneryInstancesCount,
+		sceneryBVH.getNodes().size()
+	);
+
+	RegisterScenerySection(std::move(sceneryBVH));
+	return true;
+}
+
+bool
+ProcessSceneryOverrideChunk(aChunk* chunkData)
+{
+	const bool isXenonPlatform = true;
+
+	const char* overridesData = nullptr;
+	std::size_t overridesSize = 0;
+	GetChunkData(*chunkData, overridesData, overridesSize);
+
+	SceneryOverrideInfo* overrideInfos = reinterpret_cast<SceneryOverrideInfo*>(const_cast<char*>(overridesData));
+	const std::size_t overridesCount = overridesSize / sizeof(SceneryOverrideInfo);
+	if (isXenonPlatform) {
+		EndianSwapArray(overrideInfos, overridesCount);
+	}
+
+	for (std::size_t i = 0; i < overridesCount; i++) {
+		ApplySceneryOverride(overrideInfos[i]);
+	}
+
+	dbg::Verbose("    Found {} scenery overrides", overridesCount);
+	return true;
+}
+
+bool
+ProcessSceneryGroupChunk(aChunk* chunkData)
+{
+	const bool isXenonPlatform = true;
+
+	const char* groupsData = nullptr;
+	std::size_t groupsSize = 0;
+	GetChunkData(*chunkData, groupsData, groupsSize);
+
+	std::size_t groupsCount = 0;
+	std::size_t offset = 0;
+	while (offset + sizeof(SceneryGroupHeader) <= groupsSize) {
+		SceneryGroupHeader* groupHeader = reinterpret_cast<SceneryGroupHeader*>(const_cast<char*>(groupsData + offset));
+		if (isXenonPlatform) {
+			EndianSwap(*groupHeader);
+		}
+
+		std::uint16_t* overrideNumbers = reinterpret_cast<std::uint16_t*>(groupHeader + 1);
+		const std::size_t overridesCount = static_cast<std::size_t>(std::max<std::int16_t>(groupHeader->OverridesCount, 0));
+		const std::size_t groupSize = sizeof(SceneryGroupHeader) + overridesCount * sizeof(std::uint16_t);
+		if (offset + groupSize > groupsSize) {
+			dbg::Warning("Scenery group {:#06x} is out of the chunk bounds. Skipping the rest of groups", groupHeader->NameHash);
+			break;
+		}
+
+		if (isXenonPlatform) {
+			EndianSwapArray(overrideNumbers, overridesCount);
+		}
+
+		SceneryGroupEntry groupEntry = {};
+		groupEntry.GroupNumber = groupHeader->GroupNumber;
+		groupEntry.DriveThroughBarrier = groupHeader->DriveThroughBarrier != 0;
+		groupEntry.InitiallyEnabled = groupHeader->InitiallyEnabled != 0;
+		groupEntry.OverrideInfoNumbers.assign(overrideNumbers, overrideNumbers + overridesCount);
+		SceneryGroupsMap.insert_or_assign(groupHeader->NameHash, std::move(groupEntry));
+
+		groupsCount++;
+		offset += ALIGN_VALUE(groupSize, 4);
+	}
+
+	dbg::Verbose("    Found {} scenery groups", groupsCount);
+	return true;
+}
+
+bool
+ProcessTracksChunk(aChunk* chunkData)
+{
+	const bool isXenonPlatform = true;
+
+	const char* tracksData = nullptr;
+	std::size_t tracksSize = 0;
+	GetChunkData(*chunkData, tracksData, tracksSize);
+
+	TrackInfo* trackInfos = reinterpret_cast<TrackInfo*>(const_cast<char*>(tracksData));
+	const std::size_t tracksCount = tracksSize / sizeof(TrackInfo);
+	for (std::size_t i = 0; i < tracksCount; i++) {
+		// Track infos are too big for the array swapper, they are swapped one by one
+		TrackInfo& trackInfo = trackInfos[i];
+		if (isXenonPlatform) {
+			EndianSwap(trackInfo);
+		}
 
-		nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + sizeof(aChunk));
+		dbg::Verbose("    Found track {} \"{}\" (region \"{}\", location {})",
+			trackInfo.TrackNumber,
+			std::string_view(trackInfo.Name, strnlen(trackInfo.Name, sizeof(trackInfo.Name))),
+			std::string_view(trackInfo.RegionName, strnlen(trackInfo.RegionName, sizeof(trackInfo.RegionName))),
+			trackInfo.LocationNumber
+		);
+
+		TracksMap.insert_or_assign(static_cast<std::uint32_t>(trackInfo.TrackNumber), trackInfo);
 	}
 
 	return true;
 }
 
 bool
-ProcessEventSysData(char* data, std::uint32_t dataSize)
+ProcessPCAWeightsChunk(aChunk* chunkData)
 {
-	if (std::memcmp(data, "CARP", 4) != 0) {
+	VisitChildChunks<ePcaWeights>(chunkData, ENFSChunkId::PCAWeightsData, [](ePcaWeights* weights, aChunk*) {
+		if (EntriesMap.find(weights->NameHash) != EntriesMap.end()) {
+			dbg::Verbose("    Found PCA weights data \"{}\" with hash {:#06x}", EntriesMap.at(weights->NameHash), weights->NameHash);
+		} else {
+			dbg::Verbose("    Found PCA weights data with hash {:#06x}", weights->NameHash);
+		}
+	});
+
+	return true;
+}
+
+bool
+ProcessEventSysData(char* data, std::size_t dataSize)
+{
+	if (dataSize < 20 || std::memcmp(data, "CARP", 4) != 0) {
 		return false;
 	}
 
@@ -610,15 +1205,13 @@ ProcessEventSysData(char* data, std::uint32_t dataSize)
 bool 
 ProcessEventSequenceChunk(aChunk* chunkData)
 {
-	aChunk* nextChunk = chunkData + 1;
-	aChunk* lastChunk = (aChunk*)((char*)chunkData + chunkData->Size + sizeof(aChunk));
-	while (nextChunk != lastChunk) {
-		if (!ProcessEventSysData(nextChunk->getDataPtr() + 24, nextChunk->Size)) {
+	constexpr std::size_t EventSysDataOffset = 24;
+	for (aChunk& childChunk : chunkData->getChildren()) {
+		if (childChunk.getSize() < EventSysDataOffset || !ProcessEventSysData(childChunk.getDataPtr() + EventSysDataOffset, childChunk.getSize() - EventSysDataOffset)) {
 			return false;
 		}
 
 		dbg::Verbose("    Found event sequence.");
-		nextChunk = (aChunk*)((char*)nextChunk + nextChunk->Size + sizeof(aChunk));
 	}
 
 	return true;
@@ -670,13 +1263,11 @@ ProcessSlotTypesChunk(aChunk* chunkData)
 bool
 ProcessChunk(aChunk* chunkData)
 {
+	ChunkProfileScope profileScope(chunkData);
     bool result = false;
-	const char* chunkName = (NfsChunkIdMap.find(chunkData->Id) != NfsChunkIdMap.end() ? NfsChunkIdMap.at(chunkData->Id).data() : "Unknown chunk");
 	
 	ENFSChunkId chunkEnumId = static_cast<ENFSChunkId>(chunkData->Id);
-	dbg::Verbose("");
-	dbg::Verbose("[\"{}\"]:", chunkName);
-	dbg::Verbose("--------------------------------------------------");
+	dbg::Trace(ETraceEvent::ChunkBegin, chunkData->Id, chunkData->Size);
 	switch (chunkEnumId) {
 	case ENFSChunkId::SlotTypes:
 		result = ProcessSlotTypesChunk(chunkData);
@@ -708,6 +1299,21 @@ ProcessChunk(aChunk* chunkData)
 	case ENFSChunkId::TPK_DataBlock:
 		result = ProcessTexturePackChunk(chunkData);
         break;
+	case ENFSChunkId::Geometry:
+		result = ProcessSolidListChunk(chunkData);
+		break;
+	case ENFSChunkId::SpeedScenery:
+		result = ProcessSpeedSceneryChunk(chunkData);
+		break;
+	case ENFSChunkId::SceneryOverride:
+		result = ProcessSceneryOverrideChunk(chunkData);
+		break;
+	case ENFSChunkId::SceneryGroup:
+		result = ProcessSceneryGroupChunk(chunkData);
+		break;
+	case ENFSChunkId::Tracks:
+		result = ProcessTracksChunk(chunkData);
+		break;
 	case ENFSChunkId::FEPackage:
 	case ENFSChunkId::FNGCompress:
 		result = ProcessFEPackageChunk(chunkData);
@@ -719,13 +1325,13 @@ ProcessChunk(aChunk* chunkData)
 		result = ProcessQuickSplineChunk(chunkData);
         break;
 	default:
-		dbg::Error("Can't process unknown chunk {:#06x} (\"{}\"). Skipping chunk...", chunkData->Id,chunkName);
+		dbg::Error("Can't process unknown chunk {:#06x} (\"{}\"). Skipping chunk...", chunkData->Id, GetNFSChunkName(chunkData->Id));
 		dbg::Verbose("--------------------------------------------------");
 		return false;
 	}
 
     if (!result) {
-        dbg::Error("Can't process chunk {:#06x} (\"{}\"). Skipping chunk...", chunkData->Id, chunkName);
+        dbg::Error("Can't process chunk {:#06x} (\"{}\"). Skipping chunk...", chunkData->Id, GetNFSChunkName(chunkData->Id));
     }
 
 	dbg::Verbose("--------------------------------------------------");
@@ -746,33 +1352,131 @@ OpenFile(const char* filePath)
     return EngineFactory->openFile(nfr::api::EStreamFlags::ReadFlag, globalFile);
 }
 
-bool 
-ProcessChunkedFile(nfr::api::IStream* globalStream)
+// Double-buffered chunk reader. The background thread reads chunk N+1 from
+// the stream while chunk N is being processed by the caller.
+class ChunkPrefetcher
 {
-    std::vector<char> unpackedDataBuffer;
+private:
+	nfr::api::IStream* stream;
+	ChunkFilter chunkFilter;
+
+	std::vector<char> buffers[2];
+	bool buffersReady[2] = {};
+	std::int32_t consumerIndex = 0;
+	std::int32_t acquiredIndex = -1;
+	bool endOfStream = false;
+	bool stopRequested = false;
+
+	std::mutex stateLock;
+	std::condition_variable stateChanged;
+	std::thread readThread;
+
+	bool readChunk(std::vector<char>& buffer)
+	{
+		while (!stream->isEndOfFile()) {
+			aChunk chunk = {};
+			stream->read(&chunk, sizeof(chunk));
+			if (chunk.Id == 0) {
+				continue;
+			}
 
-    while (!globalStream->isEndOfFile()) {
-        aChunk chunk = {};
-        globalStream->read(&chunk, sizeof(chunk));
-        if (chunk.Id == 0) {
-            continue;
-        }
-        
-        if (globalStream->getSize() < chunk.Size) {
-            dbg::Warning("Invalid chunk size (chunkSize: {}; fileSize: {}). Skipping chunk...", chunk.Size, globalStream->getSize());
-            continue;
-        }
+			if (stream->getSize() < chunk.Size) {
+				dbg::Warning("Invalid chunk size (chunkSize: {}; fileSize: {}). Skipping chunk...", chunk.Size, stream->getSize());
+				continue;
+			}
 
-        unpackedDataBuffer.resize(std::max(unpackedDataBuffer.size(), std::size_t(chunk.Size + sizeof(aChunk))));
-		std::memset(unpackedDataBuffer.data(), 0, unpackedDataBuffer.size());
+			if (chunkFilter && !chunkFilter(static_cast<ENFSChunkId>(chunk.Id))) {
+				stream->seek(nfr::api::EStreamMode::Current, chunk.Size);
+				continue;
+			}
 
-        globalStream->read(unpackedDataBuffer.data() + sizeof(aChunk), chunk.Size);
-        std::memcpy(unpackedDataBuffer.data(), &chunk, sizeof(aChunk));
+			buffer.resize(std::max(buffer.size(), std::size_t(chunk.Size + sizeof(aChunk))));
+			std::memset(buffer.data(), 0, buffer.size());
 
-        if (!ProcessChunk(reinterpret_cast<aChunk*>(unpackedDataBuffer.data()))) {
-            continue;
-        }
-    }
+			stream->read(buffer.data() + sizeof(aChunk), chunk.Size);
+			std::memcpy(buffer.data(), &chunk, sizeof(aChunk));
+			return true;
+		}
+
+		return false;
+	}
+
+	void threadProc()
+	{
+		std::int32_t producerIndex = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(stateLock);
+				stateChanged.wait(lock, [this, producerIndex]() { return stopRequested || !buffersReady[producerIndex]; });
+				if (stopRequested) {
+					return;
+				}
+			}
+
+			// The consumer never touches a buffer which is not ready, so it's safe to read without lock
+			const bool chunkReaded = readChunk(buffers[producerIndex]);
+
+			std::lock_guard<std::mutex> lock(stateLock);
+			if (!chunkReaded) {
+				endOfStream = true;
+				stateChanged.notify_all();
+				return;
+			}
+
+			buffersReady[producerIndex] = true;
+			stateChanged.notify_all();
+			producerIndex ^= 1;
+		}
+	}
+
+public:
+	ChunkPrefetcher(nfr::api::IStream* inStream, const ChunkFilter& inChunkFilter)
+		: stream(inStream), chunkFilter(inChunkFilter)
+	{
+		readThread = std::thread(&ChunkPrefetcher::threadProc, this);
+	}
+
+	~ChunkPrefetcher()
+	{
+		{
+			std::lock_guard<std::mutex> lock(stateLock);
+			stopRequested = true;
+			stateChanged.notify_all();
+		}
+
+		readThread.join();
+	}
+
+	// Returns the next chunk (valid until the next call) or nullptr at the end of stream
+	aChunk* next()
+	{
+		std::unique_lock<std::mutex> lock(stateLock);
+		if (acquiredIndex != -1) {
+			buffersReady[acquiredIndex] = false;
+			acquiredIndex = -1;
+			stateChanged.notify_all();
+		}
+
+		stateChanged.wait(lock, [this]() { return buffersReady[consumerIndex] || endOfStream; });
+		if (!buffersReady[consumerIndex]) {
+			return nullptr;
+		}
+
+		acquiredIndex = consumerIndex;
+		consumerIndex ^= 1;
+		return reinterpret_cast<aChunk*>(buffers[acquiredIndex].data());
+	}
+};
+
+bool 
+ProcessChunkedFile(nfr::api::IStream* globalStream, const ChunkFilter& chunkFilter)
+{
+	ChunkPrefetcher prefetcher(globalStream, chunkFilter);
+	while (aChunk* chunk = prefetcher.next()) {
+		if (!ProcessChunk(chunk)) {
+			continue;
+		}
+	}
 
     dbg::Log("All chunks are processed.");
     dbg::Verbose("");
@@ -816,15 +1520,9 @@ ProcessCompressedFile(nfr::api::IStream* compressedFile, std::vector<std::uint8_
 	JLZDecompress(compressedData.data(), decompressedData.data(), packHeader->CompressedSize, packHeader->UncompressedSize);
     dbg::Verbose("File decompressed successfully. Trying to parse chunks inside...");
     
-    std::uint32_t offset = 0;
-    while (offset < decompressedData.size()) {
-        aChunk* chunk = (aChunk*)&decompressedData[offset];
-        offset += chunk->Size + sizeof(aChunk);
-        if (chunk->Id == 0) {
-            continue;
-        }
-        
-        if (!ProcessChunk(chunk)) {
+    char* decompressedDataPtr = reinterpret_cast<char*>(decompressedData.data());
+    for (aChunk& chunk : aChunkRange(decompressedDataPtr, decompressedDataPtr + decompressedData.size())) {
+        if (!ProcessChunk(&chunk)) {
             continue;
         }
     }
@@ -869,7 +1567,7 @@ LoadCompressedFile(const char* filePath, bool saveUncompressedFile)
 }
 
 bool 
-LoadChunkedFile(const char* filePath)
+LoadChunkedFile(const char* filePath, const ChunkFilter& chunkFilter)
 {
 	nfr::api::SafeInterface<nfr::api::IStream> globalStream = OpenFile(filePath);
 	if (!globalStream->isOpen()) {
@@ -877,8 +1575,32 @@ LoadChunkedFile(const char* filePath)
 		return false;
 	}
 
+	LoadingFilePath = EngineFactory->getGameDirectory();
+	LoadingFilePath.append(filePath);
+
     dbg::Log("Processing \"{}\" file...", filePath);
-    return ProcessChunkedFile(globalStream.get());
+    const bool result = ProcessChunkedFile(globalStream.get(), chunkFilter);
+	LoadingFilePath.clear();
+	return result;
+}
+
+bool
+LoadChunkedFile(const char* filePath, std::initializer_list<ENFSChunkId> chunkIds)
+{
+	nfr::api::binary_hash_set chunkIdsSet;
+	for (ENFSChunkId chunkId : chunkIds) {
+		chunkIdsSet.insert(static_cast<std::uint32_t>(chunkId));
+	}
+
+	return LoadChunkedFile(filePath, [&chunkIdsSet](ENFSChunkId chunkId) {
+		return chunkIdsSet.find(static_cast<std::uint32_t>(chunkId)) != chunkIdsSet.end();
+	});
+}
+
+bool 
+LoadChunkedFile(const char* filePath)
+{
+	return LoadChunkedFile(filePath, ChunkFilter());
 }
 
 }
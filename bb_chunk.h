@@ -18,15 +18,62 @@
 * Boston, MA 02110-1301 USA
 *****************************************************************/
 #pragma once
+#include <functional>
+#include <initializer_list>
 
 namespace bb
 {
+	// Returns true for chunks that should be loaded, skipped chunks are seeked over without reading
+	using ChunkFilter = std::function<bool(ENFSChunkId)>;
+
+	// Aligned chunks start with 0x11 padding words which aren't part of the data
+	inline void SkipAlignPadding(const char*& data, std::size_t& dataSize, std::size_t maxPaddingSize = SIZE_MAX)
+	{
+		while (dataSize >= 4 && maxPaddingSize >= 4 && std::memcmp(data, "\x11\x11\x11\x11", 4) == 0) {
+			data += 4;
+			dataSize -= 4;
+			maxPaddingSize -= 4;
+		}
+	}
+
+	// Padding of chunks with known alignment (see GetNFSChunkAlignment) is never longer than
+	// the alignment, so data which starts with 0x11 bytes isn't taken for padding
+	inline void GetChunkData(const aChunk& chunk, const char*& outData, std::size_t& outSize)
+	{
+		outData = chunk.getDataPtr();
+		outSize = chunk.getSize();
+
+		const std::size_t alignment = GetNFSChunkAlignment(static_cast<ENFSChunkId>(chunk.Id));
+		SkipAlignPadding(outData, outSize, alignment != 0 ? alignment - 4 : SIZE_MAX);
+	}
+
+	// Calls visitor(T*, aChunk*) for every child chunk of the parent with the requested
+	// id which is big enough to contain T (padding is skipped)
+	template<typename T, typename Visitor>
+	inline void VisitChildChunks(const aChunk* parentChunk, ENFSChunkId chunkId, Visitor&& visitor)
+	{
+		for (aChunk& childChunk : parentChunk->getChildren()) {
+			if (childChunk.Id != static_cast<std::uint32_t>(chunkId)) {
+				continue;
+			}
+
+			const char* childData = nullptr;
+			std::size_t childSize = 0;
+			GetChunkData(childChunk, childData, childSize);
+			if (childSize >= sizeof(T)) {
+				visitor(reinterpret_cast<T*>(const_cast<char*>(childData)), &childChunk);
+			}
+		}
+	}
+
 	bool LoadChunkedFile(const char* filePath);
+	bool LoadChunkedFile(const char* filePath, const ChunkFilter& chunkFilter);
+	bool LoadChunkedFile(const char* filePath, std::initializer_list<ENFSChunkId> chunkIds);
     bool LoadCompressedFile(const char* filePath, bool saveUncompressedFile = false);
 
 	bool ProcessChunk(aChunk* chunkData);
 	bool ProcessTexturePackChunk(aChunk* chunkData);
 	aChunk* ProcessTexturePackDataChunk(aChunk* chunkData);
-	bool ProcessTexturePackHeaderChunk(aChunk* chunkData, TexturePackHeader& outHeader, TexturePlatInfo& outPlatInfo, std::vector<TextureInfo>& texturesInfo);
-	void ProcessTextureLoadAnimationChunk(aChunk* anumChunk);
+	bool ProcessTexturePackHeaderChunk(aChunk* chunkData, TexturePackHeader& outHeader, std::vector<TexturePlatInfo>& texturesPlatInfo, std::vector<StreamingEntry>& streamingEntries, std::vector<TextureInfo>& texturesInfo);
+	void ProcessTextureLoadAnimationChunk(aChunk* animChunk, TextureAnimationTable& animationTable);
 }
@@ -55,6 +55,7 @@ enum class EBigFilesCompression
 namespace bb
 {
 
+void JLZDecompress(std::uint8_t* input, std::uint8_t* output, std::int32_t inputLength, std::int32_t outputLength);
 bool Decompress(void* data, std::uint32_t uncompressedSize, std::uint32_t header, bool bLZ);
 #ifdef NFRAGE_TOOLS
 bool DecompressXbox(std::vector<std::uint8_t>& inputData, std::vector<std::uint8_t>& outputData);
@@ -0,0 +1,66 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#if BB_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace bb
+{
+
+static CpuFeatures
+DetectCpuFeatures()
+{
+	CpuFeatures features = {};
+#if BB_X86
+#ifdef _MSC_VER
+	int cpuInfo[4] = {};
+	__cpuid(cpuInfo, 0);
+	const int maxLeaf = cpuInfo[0];
+
+	__cpuid(cpuInfo, 1);
+	features.SSE2 = (cpuInfo[3] & (1 << 26)) != 0;
+	features.SSSE3 = (cpuInfo[2] & (1 << 9)) != 0;
+
+	const bool hasAVX = (cpuInfo[2] & (1 << 28)) != 0;
+	const bool hasOSXSave = (cpuInfo[2] & (1 << 27)) != 0;
+	if (maxLeaf >= 7 && hasAVX && hasOSXSave && (_xgetbv(0) & 0x6) == 0x6) {
+		__cpuidex(cpuInfo, 7, 0);
+		features.AVX2 = (cpuInfo[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	features.SSE2 = __builtin_cpu_supports("sse2");
+	features.SSSE3 = __builtin_cpu_supports("ssse3");
+	features.AVX2 = __builtin_cpu_supports("avx2");
+#endif
+#endif
+
+	return features;
+}
+
+const CpuFeatures&
+GetCpuFeatures()
+{
+	static const CpuFeatures features = DetectCpuFeatures();
+	return features;
+}
+
+}
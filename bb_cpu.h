@@ -0,0 +1,50 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BB_X86 1
+#ifdef _MSC_VER
+#define BB_TARGET_SSE2
+#define BB_TARGET_SSSE3
+#define BB_TARGET_AVX2
+#else
+#define BB_TARGET_SSE2 __attribute__((target("sse2")))
+#define BB_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define BB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define BB_X86 0
+#endif
+
+namespace bb
+{
+
+// Instruction sets available on the current CPU (and enabled by OS)
+struct CpuFeatures
+{
+	bool SSE2 = false;
+	bool SSSE3 = false;
+	bool AVX2 = false;
+};
+
+const CpuFeatures& GetCpuFeatures();
+
+}
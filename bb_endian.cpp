@@ -0,0 +1,98 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <numeric>
+
+#if BB_X86
+#include <tmmintrin.h>
+#endif
+
+namespace bb
+{
+
+#if BB_X86
+BB_TARGET_SSSE3 static void
+ShuffleBlocks(char* data, std::size_t periodsCount, const std::uint8_t* blockMasks, std::size_t periodSize)
+{
+	for (std::size_t period = 0; period < periodsCount; period++) {
+		for (std::size_t offset = 0; offset < periodSize; offset += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+			__m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockMasks + offset));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(data + offset), _mm_shuffle_epi8(block, mask));
+		}
+
+		data += periodSize;
+	}
+}
+#endif
+
+EndianArraySwapper::EndianArraySwapper(std::size_t inRecordSize, std::vector<std::uint8_t>&& inPermutation)
+	: recordSize(inRecordSize), permutation(std::move(inPermutation))
+{
+#if BB_X86
+	if (!GetCpuFeatures().SSSE3) {
+		return;
+	}
+
+	// Masks are repeated every lcm(record size, 16) bytes of the array
+	const std::size_t periodSize = std::lcm(recordSize, std::size_t(16));
+	blockMasks.resize(periodSize);
+	for (std::size_t i = 0; i < periodSize; i++) {
+		const std::size_t source = (i / recordSize) * recordSize + permutation[i % recordSize];
+		if ((source / 16) != (i / 16)) {
+			dbg::Verbose("Field of {} bytes record is crossing 16 bytes block. Using scalar swap.", recordSize);
+			blockMasks.clear();
+			return;
+		}
+
+		blockMasks[i] = static_cast<std::uint8_t>(source % 16);
+	}
+#endif
+}
+
+void
+EndianArraySwapper::swap(void* data, std::size_t count) const
+{
+	char* records = static_cast<char*>(data);
+
+#if BB_X86
+	if (!blockMasks.empty()) {
+		const std::size_t periodSize = blockMasks.size();
+		const std::size_t periodsCount = (recordSize * count) / periodSize;
+		ShuffleBlocks(records, periodsCount, blockMasks.data(), periodSize);
+
+		const std::size_t swappedCount = (periodsCount * periodSize) / recordSize;
+		records += swappedCount * recordSize;
+		count -= swappedCount;
+	}
+#endif
+
+	char recordCopy[256];
+	for (std::size_t i = 0; i < count; i++) {
+		std::memcpy(recordCopy, records, recordSize);
+		for (std::size_t j = 0; j < recordSize; j++) {
+			records[j] = recordCopy[permutation[j]];
+		}
+
+		records += recordSize;
+	}
+}
+
+}
@@ -0,0 +1,406 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace bb
+{
+
+// Describes the fields of the structure which have to be byte swapped on big endian
+// platforms. Fields which are not listed (char arrays, paddings, pointers) are left untouched.
+template<typename T>
+struct EndianFields
+{
+	static constexpr bool Described = false;
+};
+
+#define BB_ENDIAN_FIELDS(Type, ...) \
+	template<> \
+	struct EndianFields<Type> \
+	{ \
+		static constexpr bool Described = true; \
+		static constexpr std::size_t WordSize = 0; \
+		static constexpr auto Fields = std::make_tuple(__VA_ARGS__); \
+	};
+
+// The whole structure is an array of words with the same size (e.g. only floats)
+#define BB_ENDIAN_WORDS(Type, Word) \
+	template<> \
+	struct EndianFields<Type> \
+	{ \
+		static_assert(sizeof(Type) % sizeof(Word) == 0, "Structure can't be represented as array of words"); \
+		static constexpr bool Described = true; \
+		static constexpr std::size_t WordSize = sizeof(Word); \
+		static constexpr auto Fields = std::make_tuple(); \
+	};
+
+template<typename T>
+void EndianSwap(T& value);
+
+template<typename T>
+inline void EndianSwapValue(T& value)
+{
+	if constexpr (std::is_array_v<T>) {
+		for (auto& element : value) {
+			EndianSwapValue(element);
+		}
+	} else if constexpr (std::is_class_v<T>) {
+		EndianSwap(value);
+	} else if constexpr (sizeof(T) == 2) {
+		std::uint16_t bits = 0;
+		std::memcpy(&bits, &value, sizeof(bits));
+		bits = BYTESWAP_SHORT(bits);
+		std::memcpy(&value, &bits, sizeof(bits));
+	} else if constexpr (sizeof(T) == 4) {
+		std::uint32_t bits = 0;
+		std::memcpy(&bits, &value, sizeof(bits));
+		bits = BYTESWAP_LONG(bits);
+		std::memcpy(&value, &bits, sizeof(bits));
+	} else if constexpr (sizeof(T) == 8) {
+		std::uint64_t bits = 0;
+		std::memcpy(&bits, &value, sizeof(bits));
+		bits = BYTESWAP_LONGLONG(bits);
+		std::memcpy(&value, &bits, sizeof(bits));
+	} else {
+		static_assert(sizeof(T) == 1, "Unsupported field size for endian swap");
+	}
+}
+
+// Swaps all described fields of the structure in place
+template<typename T>
+inline void EndianSwap(T& value)
+{
+	if constexpr (std::is_class_v<T>) {
+		static_assert(EndianFields<T>::Described, "Structure has no endian fields description (see BB_ENDIAN_FIELDS)");
+		if constexpr (EndianFields<T>::WordSize == 2) {
+			EndianSwapValue(reinterpret_cast<std::uint16_t(&)[sizeof(T) / 2]>(value));
+		} else if constexpr (EndianFields<T>::WordSize == 4) {
+			EndianSwapValue(reinterpret_cast<std::uint32_t(&)[sizeof(T) / 4]>(value));
+		} else {
+			std::apply([&value](auto... fields) {
+				(EndianSwapValue(value.*fields), ...);
+			}, EndianFields<T>::Fields);
+		}
+	} else {
+		EndianSwapValue(value);
+	}
+}
+
+template<typename T>
+void BuildEndianPermutation(std::vector<std::uint8_t>& permutation, std::size_t offset);
+
+template<typename T>
+inline void MarkEndianValue(std::vector<std::uint8_t>& permutation, std::size_t offset)
+{
+	if constexpr (std::is_array_v<T>) {
+		using ElementType = std::remove_extent_t<T>;
+		for (std::size_t i = 0; i < std::extent_v<T>; i++) {
+			MarkEndianValue<ElementType>(permutation, offset + i * sizeof(ElementType));
+		}
+	} else if constexpr (std::is_class_v<T>) {
+		BuildEndianPermutation<T>(permutation, offset);
+	} else {
+		std::reverse(permutation.begin() + offset, permutation.begin() + offset + sizeof(T));
+	}
+}
+
+template<typename C, typename M>
+inline std::size_t GetFieldOffset(M C::* field)
+{
+	alignas(C) static const char storage[sizeof(C)] = {};
+	const C* object = reinterpret_cast<const C*>(storage);
+	return reinterpret_cast<const char*>(&(object->*field)) - storage;
+}
+
+// Builds byte permutation for the whole record. Every swapped field has its bytes reversed.
+template<typename T>
+inline void BuildEndianPermutation(std::vector<std::uint8_t>& permutation, std::size_t offset)
+{
+	if constexpr (std::is_class_v<T>) {
+		if constexpr (EndianFields<T>::WordSize == 2) {
+			MarkEndianValue<std::uint16_t[sizeof(T) / 2]>(permutation, offset);
+		} else if constexpr (EndianFields<T>::WordSize == 4) {
+			MarkEndianValue<std::uint32_t[sizeof(T) / 4]>(permutation, offset);
+		} else {
+			std::apply([&permutation, offset](auto... fields) {
+				(MarkEndianValue<std::remove_reference_t<decltype(std::declval<T&>().*fields)>>(permutation, offset + GetFieldOffset(fields)), ...);
+			}, EndianFields<T>::Fields);
+		}
+	} else {
+		MarkEndianValue<T>(permutation, offset);
+	}
+}
+
+// Applies the byte permutation of one record to the array of records. Uses SSSE3 shuffles
+// if they are supported by CPU and no swapped field crosses 16-byte block in the array.
+class EndianArraySwapper
+{
+private:
+	std::size_t recordSize;
+	std::vector<std::uint8_t> permutation;
+	std::vector<std::uint8_t> blockMasks;
+
+public:
+	EndianArraySwapper(std::size_t inRecordSize, std::vector<std::uint8_t>&& inPermutation);
+
+	void swap(void* data, std::size_t count) const;
+};
+
+template<typename T>
+inline const EndianArraySwapper& GetEndianArraySwapper()
+{
+	static const EndianArraySwapper arraySwapper = []() {
+		std::vector<std::uint8_t> permutation(sizeof(T));
+		for (std::size_t i = 0; i < permutation.size(); i++) {
+			permutation[i] = static_cast<std::uint8_t>(i);
+		}
+
+		BuildEndianPermutation<T>(permutation, 0);
+		return EndianArraySwapper(sizeof(T), std::move(permutation));
+	}();
+
+	return arraySwapper;
+}
+
+// Swaps all described fields in the array of records
+template<typename T>
+inline void EndianSwapArray(T* values, std::size_t count)
+{
+	static_assert(sizeof(T) <= 256, "Record is too big for byte permutation");
+	GetEndianArraySwapper<T>().swap(values, count);
+}
+
+BB_ENDIAN_FIELDS(TextureVRAMDataHeader,
+	&TextureVRAMDataHeader::Version,
+	&TextureVRAMDataHeader::FilenameHash
+)
+
+BB_ENDIAN_FIELDS(TexturePackHeader,
+	&TexturePackHeader::Version,
+	&TexturePackHeader::FilenameHash,
+	&TexturePackHeader::PermChunkByteOffset,
+	&TexturePackHeader::PermChunkByteSize
+)
+
+BB_ENDIAN_FIELDS(TextureIndexEntry,
+	&TextureIndexEntry::NameHash,
+	&TextureIndexEntry::Padding
+)
+
+BB_ENDIAN_FIELDS(StreamingEntry,
+	&StreamingEntry::NameHash,
+	&StreamingEntry::ChunkByteOffset,
+	&StreamingEntry::ChunkByteSize,
+	&StreamingEntry::UncompressedSize,
+	&StreamingEntry::RefCount,
+	&StreamingEntry::Padding
+)
+
+BB_ENDIAN_WORDS(RenderState, std::uint32_t)
+
+BB_ENDIAN_FIELDS(TexturePlatInfo,
+	&TexturePlatInfo::mRenderState,
+	&TexturePlatInfo::type,
+	&TexturePlatInfo::Pad0,
+	&TexturePlatInfo::PunchThruValue,
+	&TexturePlatInfo::format
+)
+
+BB_ENDIAN_FIELDS(TextureInfo,
+	&TextureInfo::NameHash,
+	&TextureInfo::ClassNameHash,
+	&TextureInfo::ImagePlacement,
+	&TextureInfo::PalettePlacement,
+	&TextureInfo::ImageSize,
+	&TextureInfo::PaletteSize,
+	&TextureInfo::BaseImageSize,
+	&TextureInfo::Width,
+	&TextureInfo::Height,
+	&TextureInfo::NumPaletteEntries,
+	&TextureInfo::ScrollTimeStep,
+	&TextureInfo::ScrollSpeedS,
+	&TextureInfo::ScrollSpeedT,
+	&TextureInfo::OffsetS,
+	&TextureInfo::OffsetT,
+	&TextureInfo::ScaleS,
+	&TextureInfo::ScaleT,
+	&TextureInfo::PaletteData
+)
+
+BB_ENDIAN_FIELDS(TextureAnim,
+	&TextureAnim::NameHash
+)
+
+BB_ENDIAN_FIELDS(TextureAnimEntry,
+	&TextureAnimEntry::NameHash
+)
+
+BB_ENDIAN_FIELDS(OldEngineFont,
+	&OldEngineFont::Size,
+	&OldEngineFont::Version,
+	&OldEngineFont::Num,
+	&OldEngineFont::Flags,
+	&OldEngineFont::GlyphTbl,
+	&OldEngineFont::KernTbl,
+	&OldEngineFont::Shape,
+	&OldEngineFont::States
+)
+
+BB_ENDIAN_WORDS(MaterialInfo, float)
+
+BB_ENDIAN_FIELDS(MaterialStruct,
+	&MaterialStruct::NameHash,
+	&MaterialStruct::Version,
+	&MaterialStruct::Data
+)
+
+BB_ENDIAN_FIELDS(LightPack,
+	&LightPack::Version,
+	&LightPack::ScenerySectionNumber,
+	&LightPack::NumTreeNodes,
+	&LightPack::NumLights
+)
+
+BB_ENDIAN_FIELDS(AABBTree,
+	&AABBTree::NumLeafNodes,
+	&AABBTree::NumParentNodes,
+	&AABBTree::TotalNodes,
+	&AABBTree::Depth
+)
+
+BB_ENDIAN_FIELDS(GameLight,
+	&GameLight::NameHash,
+	&GameLight::ExcludeNameHash,
+	&GameLight::Colour,
+	&GameLight::PositionX,
+	&GameLight::PositionY,
+	&GameLight::PositionZ,
+	&GameLight::Size,
+	&GameLight::DirectionX,
+	&GameLight::DirectionY,
+	&GameLight::DirectionZ,
+	&GameLight::Intensity,
+	&GameLight::FarStart,
+	&GameLight::FarEnd,
+	&GameLight::Falloff,
+	&GameLight::ScenerySectionNumber
+)
+
+BB_ENDIAN_FIELDS(SolidListHeader,
+	&SolidListHeader::Version,
+	&SolidListHeader::NumSolids,
+	&SolidListHeader::PermChunkByteOffset,
+	&SolidListHeader::PermChunkByteSize,
+	&SolidListHeader::MaxSolidChunkByteAlignment,
+	&SolidListHeader::NumTexturePacks,
+	&SolidListHeader::NumDefaultTextures
+)
+
+BB_ENDIAN_FIELDS(SolidIndexEntry,
+	&SolidIndexEntry::NameHash
+)
+
+BB_ENDIAN_FIELDS(SolidInfo,
+	&SolidInfo::Flags,
+	&SolidInfo::NameHash,
+	&SolidInfo::NumPolys,
+	&SolidInfo::NumVerts,
+	&SolidInfo::ReferencedFrameCounter,
+	&SolidInfo::AABBMinX,
+	&SolidInfo::AABBMinY,
+	&SolidInfo::AABBMinZ,
+	&SolidInfo::AABBMaxX,
+	&SolidInfo::AABBMaxY,
+	&SolidInfo::AABBMaxZ,
+	&SolidInfo::PivotMatrix,
+	&SolidInfo::Volume,
+	&SolidInfo::Density
+)
+
+BB_ENDIAN_FIELDS(SolidTextureEntry,
+	&SolidTextureEntry::NameHash
+)
+
+BB_ENDIAN_FIELDS(SolidMeshInfo,
+	&SolidMeshInfo::Flags,
+	&SolidMeshInfo::NumMeshEntries,
+	&SolidMeshInfo::NumVertexBuffers,
+	&SolidMeshInfo::NumIndices
+)
+
+BB_ENDIAN_FIELDS(SolidMeshEntry,
+	&SolidMeshEntry::BoundsMin,
+	&SolidMeshEntry::BoundsMax,
+	&SolidMeshEntry::Flags,
+	&SolidMeshEntry::VertexBufferIndex,
+	&SolidMeshEntry::NumVertices,
+	&SolidMeshEntry::FirstIndex,
+	&SolidMeshEntry::NumIndices
+)
+
+BB_ENDIAN_FIELDS(ScenerySectionHeader,
+	&ScenerySectionHeader::ChunksLoaded,
+	&ScenerySectionHeader::SectionNumber
+)
+
+BB_ENDIAN_FIELDS(SceneryInfo,
+	&SceneryInfo::SolidMeshKey,
+	&SceneryInfo::SceneryFlags,
+	&SceneryInfo::Radius,
+	&SceneryInfo::HierarchyKey
+)
+
+BB_ENDIAN_FIELDS(SceneryInstance,
+	&SceneryInstance::BBoxMin,
+	&SceneryInstance::BBoxMax,
+	&SceneryInstance::ExcludeFlags,
+	&SceneryInstance::PrecullerInfoIndex,
+	&SceneryInstance::LightingContextNumber,
+	&SceneryInstance::SceneryInfoNumber,
+	&SceneryInstance::Position,
+	&SceneryInstance::Rotation
+)
+
+BB_ENDIAN_FIELDS(SceneryOverrideInfo,
+	&SceneryOverrideInfo::SectionNumber,
+	&SceneryOverrideInfo::InstanceNumber,
+	&SceneryOverrideInfo::ExcludeFlags
+)
+
+BB_ENDIAN_FIELDS(SceneryGroupHeader,
+	&SceneryGroupHeader::NameHash,
+	&SceneryGroupHeader::GroupNumber,
+	&SceneryGroupHeader::OverridesCount
+)
+
+BB_ENDIAN_FIELDS(TrackInfo,
+	&TrackInfo::LocationNumber,
+	&TrackInfo::LocationType,
+	&TrackInfo::TrackNumber,
+	&TrackInfo::SameAsTrackNumber,
+	&TrackInfo::SunInfoNameHash,
+	&TrackInfo::UsageFlags
+)
+
+}
@@ -32,6 +32,9 @@ const std::unordered_map<std::uint32_t, std::string_view> NfsChunkIdMap =
 	{ 0x00030250, "PresetSkins"				},
 	{ 0x00034026, "Smokeables"				},
 	{ 0x00034027, "WorldBounds"				},
+	{ 0x00034101, "ScenerySectionHeader"	},
+	{ 0x00034102, "SceneryInfo"				},
+	{ 0x00034103, "SceneryInstance"			},
 	{ 0x00034107, "SceneryOverride"			},
 	{ 0x00034108, "SceneryGroup"			},
 	{ 0x00034146, "TrackPosMarkers"			},
@@ -245,6 +248,12 @@ const std::unordered_map<std::uint32_t, std::string_view> TexturesFormatMap =
 
 namespace bb
 {
+	const char* GetNFSChunkName(std::uint32_t chunkId)
+	{
+		auto chunkNameIt = NfsChunkIdMap.find(chunkId);
+		return chunkNameIt != NfsChunkIdMap.end() ? chunkNameIt->second.data() : "Unknown chunk";
+	}
+
 	EGameVersion DetectNFSGameVersionFromEntries(std::vector<aFileDirectoryEntry>& entries)
 	{
 		std::uint32_t ProStreetCheck = nfr::api::getBinaryHash("TRACKS\\L6R_FE.BUN");
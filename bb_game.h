@@ -70,6 +70,8 @@ namespace bb
 		return "Unknown version";
 	}
 
+	const char* GetNFSChunkName(std::uint32_t chunkId);
+
 	EGameVersion DetectNFSGameVersionFromEntries(std::vector<aFileDirectoryEntry>& entries);
 	EGameVersion DetectNFSGameVersionFromFiles();
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+
+namespace bb
+{
+
+static bool
+ParseSolidMesh(aChunk* meshChunk, bool bEndianSwapped, SolidView& outSolid)
+{
+	for (aChunk& childChunk : meshChunk->getChildren()) {
+		const char* chunkData = nullptr;
+		std::size_t chunkSize = 0;
+		GetChunkData(childChunk, chunkData, chunkSize);
+
+		switch (static_cast<ENFSChunkId>(childChunk.Id)) {
+		case ENFSChunkId::SolidMeshInfo: {
+			if (chunkSize < sizeof(SolidMeshInfo)) {
+				return false;
+			}
+
+			SolidMeshInfo* meshInfo = reinterpret_cast<SolidMeshInfo*>(const_cast<char*>(chunkData));
+			if (bEndianSwapped) {
+				EndianSwap(*meshInfo);
+			}
+
+			outSolid.MeshInfo = meshInfo;
+		}
+		break;
+
+		case ENFSChunkId::SolidMeshEntries: {
+			SolidMeshEntry* meshEntries = reinterpret_cast<SolidMeshEntry*>(const_cast<char*>(chunkData));
+			outSolid.MeshEntriesCount = chunkSize / sizeof(SolidMeshEntry);
+			if (bEndianSwapped) {
+				EndianSwapArray(meshEntries, outSolid.MeshEntriesCount);
+			}
+
+			outSolid.MeshEntries = meshEntries;
+		}
+		break;
+
+		case ENFSChunkId::SolidVertexBuffer: {
+			outSolid.VertexBuffers.push_back({ chunkData, chunkSize, 0, 0, bEndianSwapped });
+		}
+		break;
+
+		case ENFSChunkId::SolidIndexBuffer: {
+			std::uint16_t* indices = reinterpret_cast<std::uint16_t*>(const_cast<char*>(chunkData));
+			outSolid.IndicesCount = chunkSize / sizeof(std::uint16_t);
+			if (bEndianSwapped) {
+				EndianSwapArray(indices, outSolid.IndicesCount);
+			}
+
+			outSolid.Indices = indices;
+		}
+		break;
+
+		default:
+			break;
+		}
+	}
+
+	// Vertex buffers have no description, the stride is found from vertices count of mesh entries
+	for (std::size_t i = 0; i < outSolid.MeshEntriesCount; i++) {
+		const SolidMeshEntry& meshEntry = outSolid.MeshEntries[i];
+		if (meshEntry.VertexBufferIndex < 0 || static_cast<std::size_t>(meshEntry.VertexBufferIndex) >= outSolid.VertexBuffers.size()) {
+			dbg::Warning("Mesh entry {} of solid {:#06x} refers to missing vertex buffer {}.", i, outSolid.Info->NameHash, meshEntry.VertexBufferIndex);
+			return false;
+		}
+
+		if (meshEntry.FirstIndex < 0 || meshEntry.NumIndices < 0 || static_cast<std::size_t>(meshEntry.FirstIndex) + meshEntry.NumIndices > outSolid.IndicesCount) {
+			dbg::Warning("Mesh entry {} of solid {:#06x} is out of the index buffer.", i, outSolid.Info->NameHash);
+			return false;
+		}
+
+		outSolid.VertexBuffers[meshEntry.VertexBufferIndex].VerticesCount += std::max(0, meshEntry.NumVertices);
+	}
+
+	for (SolidVertexBufferView& vertexBuffer : outSolid.VertexBuffers) {
+		if (vertexBuffer.VerticesCount == 0) {
+			continue;
+		}
+
+		// Buffers can be padded at the end, so the stride is rounded down
+		const std::size_t stride = vertexBuffer.Size / vertexBuffer.VerticesCount;
+		if (stride < sizeof(float) * 3) {
+			dbg::Warning("Vertex buffer of solid {:#06x} is too small ({} bytes for {} vertices).", outSolid.Info->NameHash, vertexBuffer.Size, vertexBuffer.VerticesCount);
+			return false;
+		}
+
+		vertexBuffer.Stride = static_cast<std::uint32_t>(stride);
+	}
+
+	return true;
+}
+
+bool
+ParseSolid(aChunk* solidChunk, SolidView& outSolid)
+{
+	bool bEndianSwapped = false;
+	aChunk* meshChunk = nullptr;
+	for (aChunk& childChunk : solidChunk->getChildren()) {
+		switch (static_cast<ENFSChunkId>(childChunk.Id)) {
+		case ENFSChunkId::SolidInfo: {
+			if (childChunk.getSize() < sizeof(SolidInfo)) {
+				return false;
+			}
+
+			SolidInfo* solidInfo = childChunk.getDataPtr<SolidInfo>();
+			bEndianSwapped = !!solidInfo->EndianSwapped;
+			if (bEndianSwapped) {
+				EndianSwap(*solidInfo);
+				solidInfo->EndianSwapped = 0;
+			}
+
+			const char* solidName = childChunk.getDataPtr() + sizeof(SolidInfo);
+			outSolid.Info = solidInfo;
+			outSolid.Name = std::string_view(solidName, strnlen(solidName, childChunk.getSize() - sizeof(SolidInfo)));
+		}
+		break;
+
+		case ENFSChunkId::SolidTextures: {
+			SolidTextureEntry* textures = childChunk.getDataPtr<SolidTextureEntry>();
+			outSolid.TexturesCount = childChunk.getSize() / sizeof(SolidTextureEntry);
+			if (bEndianSwapped) {
+				EndianSwapArray(textures, outSolid.TexturesCount);
+			}
+
+			outSolid.Textures = textures;
+		}
+		break;
+
+		case ENFSChunkId::SolidMesh: {
+			meshChunk = &childChunk;
+		}
+		break;
+
+		default:
+			break;
+		}
+	}
+
+	if (outSolid.Info == nullptr) {
+		dbg::Warning("No solid info was found in geometry data chunk. Skipping the solid...");
+		return false;
+	}
+
+	// Mesh is parsed when the endianness of the solid is already known
+	if (meshChunk != nullptr && !ParseSolidMesh(meshChunk, bEndianSwapped, outSolid)) {
+		return false;
+	}
+
+	for (std::size_t i = 0; i < outSolid.MeshEntriesCount; i++) {
+		for (std::uint8_t textureIndex : outSolid.MeshEntries[i].TextureIndices) {
+			if (textureIndex != 0xFF && textureIndex >= outSolid.TexturesCount) {
+				dbg::Warning("Mesh entry {} of solid \"{}\" refers to missing texture {}.", i, outSolid.Name, textureIndex);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+}
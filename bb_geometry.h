@@ -0,0 +1,96 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+// Vertex layout depends on the shader, only the stride is known. Every vertex starts with float3 position.
+struct SolidVertexBufferView
+{
+	const char* Data;
+	std::size_t Size;
+	std::uint32_t Stride;			// 0 if it can't be found from mesh entries
+	std::uint32_t VerticesCount;
+	bool BigEndian;					// vertex data is never swapped in place
+
+	// Returns false if the vertex is out of the buffer or the layout is unknown
+	bool getPosition(std::uint32_t vertexIndex, float outPosition[3]) const
+	{
+		if (Stride == 0 || vertexIndex >= VerticesCount) {
+			return false;
+		}
+
+		std::uint32_t words[3] = {};
+		std::memcpy(words, Data + static_cast<std::size_t>(vertexIndex) * Stride, sizeof(words));
+		if (BigEndian) {
+			EndianSwapValue(words);
+		}
+
+		std::memcpy(outPosition, words, sizeof(words));
+		return true;
+	}
+};
+
+/*
+	Views point to the memory of the Geometry chunk, solids aren't copied one by one. Tables and
+	indices of big endian solids are swapped in place while parsing.
+*/
+struct SolidView
+{
+	const SolidInfo* Info = nullptr;
+	std::string_view Name;
+
+	const SolidTextureEntry* Textures = nullptr;
+	std::size_t TexturesCount = 0;
+
+	const SolidMeshInfo* MeshInfo = nullptr;
+	const SolidMeshEntry* MeshEntries = nullptr;
+	std::size_t MeshEntriesCount = 0;
+
+	std::vector<SolidVertexBufferView> VertexBuffers;
+
+	const std::uint16_t* Indices = nullptr;
+	std::size_t IndicesCount = 0;
+};
+
+struct SolidListView
+{
+	const SolidListHeader* Header = nullptr;
+	const SolidIndexEntry* IndexEntries = nullptr;
+	std::size_t IndexEntriesCount = 0;
+	std::vector<SolidView> Solids;
+};
+
+// Loaded solid list with its own copy of the Geometry chunk. Chunk buffers of the loader are reused
+// for the next chunks, so the views point to ChunkData (its memory isn't moved with the struct).
+struct SolidListData
+{
+	std::vector<char> ChunkData;
+	SolidListView View;
+};
+
+// Solid lists by the upper hash of their file name
+extern nfr::api::binary_hash_map<SolidListData> SolidListsMap;
+
+// Parses GeometryData chunk of one solid. Views are valid while the chunk memory is alive.
+bool ParseSolid(aChunk* solidChunk, SolidView& outSolid);
+
+}
@@ -253,11 +253,7 @@ bool UnpackXboxData()
                 }
             }
             
-			dbg::Log("        entry {}: crc32: {:#06x}; hash: {:#06x} ",
-				fileName,
-				entry.Checksum,
-				entry.Hash
-			);
+			dbg::Trace(ETraceEvent::FileEntry, entry.Hash, entry.Checksum);
 
 			nfr::api::path newFilePath = EngineFactory->getGameDirectory();
 			newFilePath.append(fileName);
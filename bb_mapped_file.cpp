@@ -0,0 +1,138 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bb
+{
+
+#ifdef _WIN32
+bool
+MappedFile::open(const nfr::api::path& filePath)
+{
+	close();
+
+	HANDLE file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<const char*>(view);
+	size = static_cast<std::size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void
+MappedFile::close()
+{
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+	}
+
+	data = nullptr;
+	size = 0;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+#else
+bool
+MappedFile::open(const nfr::api::path& filePath)
+{
+	close();
+
+	const int file = ::open(filePath.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat fileStat = {};
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+		::close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED) {
+		::close(file);
+		return false;
+	}
+
+	fileDescriptor = file;
+	data = static_cast<const char*>(view);
+	size = static_cast<std::size_t>(fileStat.st_size);
+	return true;
+}
+
+void
+MappedFile::close()
+{
+	if (data != nullptr) {
+		munmap(const_cast<char*>(data), size);
+	}
+
+	if (fileDescriptor >= 0) {
+		::close(fileDescriptor);
+	}
+
+	data = nullptr;
+	size = 0;
+	fileDescriptor = -1;
+}
+#endif
+
+}
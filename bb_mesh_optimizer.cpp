@@ -0,0 +1,572 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+namespace bb
+{
+
+static constexpr std::uint32_t VertexCacheSize = 32;
+static constexpr std::uint32_t MaxValenceScore = 64;
+static constexpr double OverdrawThreshold = 1.05;
+
+// Scores of Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+struct VertexScoreTable
+{
+	float CacheScores[VertexCacheSize];
+	float ValenceScores[MaxValenceScore];
+
+	VertexScoreTable()
+	{
+		for (std::uint32_t i = 0; i < VertexCacheSize; i++) {
+			// Vertices of the last triangle get the fixed score, so it isn't used again immediately
+			CacheScores[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / float(VertexCacheSize - 3), 1.5f);
+		}
+
+		ValenceScores[0] = 0.0f;
+		for (std::uint32_t i = 1; i < MaxValenceScore; i++) {
+			ValenceScores[i] = 2.0f / std::sqrt(float(i));
+		}
+	}
+};
+
+static const VertexScoreTable ScoreTable;
+
+static inline float
+GetVertexScore(std::int32_t cachePosition, std::uint32_t remainingValence)
+{
+	if (remainingValence == 0) {
+		return -1.0f;
+	}
+
+	const float cacheScore = cachePosition >= 0 ? ScoreTable.CacheScores[cachePosition] : 0.0f;
+	return cacheScore + ScoreTable.ValenceScores[std::min(remainingValence, MaxValenceScore - 1)];
+}
+
+// indices are in [0; verticesCount), the result is written to outIndices
+static void
+OptimizeVertexCache(const std::uint32_t* indices, std::size_t indicesCount, std::size_t verticesCount, std::uint32_t* outIndices)
+{
+	const std::size_t trianglesCount = indicesCount / 3;
+
+	std::vector<std::uint32_t> adjacencyOffsets(verticesCount + 1, 0);
+	for (std::size_t i = 0; i < indicesCount; i++) {
+		adjacencyOffsets[indices[i] + 1]++;
+	}
+
+	std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+	// Triangles of every vertex, the remaining ones are kept at the beginning of the range
+	std::vector<std::uint32_t> adjacency(indicesCount);
+	std::vector<std::uint32_t> valences(verticesCount, 0);
+	for (std::size_t i = 0; i < indicesCount; i++) {
+		const std::uint32_t vertex = indices[i];
+		adjacency[adjacencyOffsets[vertex] + valences[vertex]++] = static_cast<std::uint32_t>(i / 3);
+	}
+
+	std::vector<std::int32_t> cachePositions(verticesCount, -1);
+	std::vector<float> vertexScores(verticesCount);
+	for (std::size_t i = 0; i < verticesCount; i++) {
+		vertexScores[i] = GetVertexScore(-1, valences[i]);
+	}
+
+	std::vector<float> triangleScores(trianglesCount);
+	std::vector<std::uint8_t> trianglesEmitted(trianglesCount, 0);
+	for (std::size_t i = 0; i < trianglesCount; i++) {
+		triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+	}
+
+	std::vector<std::uint32_t> cache;
+	std::vector<std::uint32_t> newCache;
+	cache.reserve(VertexCacheSize + 3);
+	newCache.reserve(VertexCacheSize + 3);
+
+	std::size_t emittedCount = 0;
+	std::size_t inputCursor = 0;
+	std::int64_t bestTriangle = -1;
+	while (emittedCount < trianglesCount) {
+		// Dead end: no triangle uses cached vertices, the next one in the input order is taken
+		if (bestTriangle < 0) {
+			while (trianglesEmitted[inputCursor]) {
+				inputCursor++;
+			}
+
+			bestTriangle = static_cast<std::int64_t>(inputCursor);
+		}
+
+		const std::uint32_t* triangle = indices + bestTriangle * 3;
+		std::memcpy(outIndices + emittedCount * 3, triangle, sizeof(std::uint32_t) * 3);
+		trianglesEmitted[bestTriangle] = 1;
+		emittedCount++;
+
+		for (std::size_t k = 0; k < 3; k++) {
+			const std::uint32_t vertex = triangle[k];
+			std::uint32_t* vertexTriangles = adjacency.data() + adjacencyOffsets[vertex];
+			std::uint32_t* lastTriangle = vertexTriangles + valences[vertex] - 1;
+			std::uint32_t* emittedTriangle = std::find(vertexTriangles, lastTriangle + 1, static_cast<std::uint32_t>(bestTriangle));
+			if (emittedTriangle <= lastTriangle) {
+				std::swap(*emittedTriangle, *lastTriangle);
+				valences[vertex]--;
+			}
+		}
+
+		// Vertices of the triangle go to the front of LRU cache
+		newCache.assign(triangle, triangle + 3);
+		for (std::uint32_t vertex : cache) {
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+				newCache.push_back(vertex);
+			}
+		}
+
+		for (std::size_t i = VertexCacheSize; i < newCache.size(); i++) {
+			cachePositions[newCache[i]] = -1;
+			vertexScores[newCache[i]] = GetVertexScore(-1, valences[newCache[i]]);
+		}
+
+		if (newCache.size() > VertexCacheSize) {
+			newCache.resize(VertexCacheSize);
+		}
+
+		std::swap(cache, newCache);
+		for (std::size_t i = 0; i < cache.size(); i++) {
+			cachePositions[cache[i]] = static_cast<std::int32_t>(i);
+			vertexScores[cache[i]] = GetVertexScore(static_cast<std::int32_t>(i), valences[cache[i]]);
+		}
+
+		// Only triangles of cached vertices can change their scores
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (std::uint32_t vertex : cache) {
+			const std::uint32_t* vertexTriangles = adjacency.data() + adjacencyOffsets[vertex];
+			for (std::uint32_t i = 0; i < valences[vertex]; i++) {
+				const std::uint32_t triangleIndex = vertexTriangles[i];
+				const std::uint32_t* cachedTriangle = indices + triangleIndex * 3;
+				const float score = vertexScores[cachedTriangle[0]] + vertexScores[cachedTriangle[1]] + vertexScores[cachedTriangle[2]];
+				triangleScores[triangleIndex] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = triangleIndex;
+				}
+			}
+		}
+	}
+}
+
+static std::uint64_t
+CountCacheMisses(const std::uint32_t* indices, std::size_t indicesCount, std::size_t verticesCount)
+{
+	std::vector<std::uint32_t> timestamps(verticesCount, 0);
+	std::uint32_t timestamp = MeshOptimizer::MeasureCacheSize + 1;
+	std::uint64_t missesCount = 0;
+	for (std::size_t i = 0; i < indicesCount; i++) {
+		if (timestamp - timestamps[indices[i]] > MeshOptimizer::MeasureCacheSize) {
+			timestamps[indices[i]] = timestamp++;
+			missesCount++;
+		}
+	}
+
+	return missesCount;
+}
+
+struct TriangleCluster
+{
+	std::size_t FirstTriangle;
+	std::size_t TrianglesCount;
+	float SortKey;
+};
+
+// Clusters start where the cache was flushed (every vertex of the triangle is a miss), so they can
+// be moved without making ACMR much worse. Clusters facing outside of the mesh are drawn first.
+static void
+OptimizeOverdraw(std::uint32_t* indices, std::size_t indicesCount, const std::vector<float>& positions)
+{
+	const std::size_t trianglesCount = indicesCount / 3;
+	const std::size_t verticesCount = positions.size() / 3;
+	if (trianglesCount < 2) {
+		return;
+	}
+
+	std::vector<TriangleCluster> clusters;
+	std::vector<std::uint32_t> timestamps(verticesCount, 0);
+	std::uint32_t timestamp = MeshOptimizer::MeasureCacheSize + 1;
+	for (std::size_t i = 0; i < trianglesCount; i++) {
+		std::uint32_t missesCount = 0;
+		for (std::size_t k = 0; k < 3; k++) {
+			const std::uint32_t vertex = indices[i * 3 + k];
+			if (timestamp - timestamps[vertex] > MeshOptimizer::MeasureCacheSize) {
+				timestamps[vertex] = timestamp++;
+				missesCount++;
+			}
+		}
+
+		if (clusters.empty() || missesCount == 3) {
+			clusters.push_back({ i, 0, 0.0f });
+		}
+
+		clusters.back().TrianglesCount++;
+	}
+
+	if (clusters.size() < 2) {
+		return;
+	}
+
+	float meshCentroid[3] = {};
+	float meshArea = 0.0f;
+	std::vector<float> clusterData(clusters.size() * 6);	// centroid, normal
+	for (std::size_t c = 0; c < clusters.size(); c++) {
+		float* centroid = clusterData.data() + c * 6;
+		float* normal = centroid + 3;
+		float clusterArea = 0.0f;
+		for (std::size_t i = clusters[c].FirstTriangle; i < clusters[c].FirstTriangle + clusters[c].TrianglesCount; i++) {
+			const float* p0 = positions.data() + indices[i * 3] * 3;
+			const float* p1 = positions.data() + indices[i * 3 + 1] * 3;
+			const float* p2 = positions.data() + indices[i * 3 + 2] * 3;
+			const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float cross[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			const float area = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+			for (std::size_t k = 0; k < 3; k++) {
+				centroid[k] += (p0[k] + p1[k] + p2[k]) * area / 3.0f;
+				normal[k] += cross[k];
+			}
+
+			clusterArea += area;
+		}
+
+		for (std::size_t k = 0; k < 3; k++) {
+			meshCentroid[k] += centroid[k];
+			centroid[k] /= std::max(clusterArea, 1e-12f);
+		}
+
+		meshArea += clusterArea;
+	}
+
+	for (std::size_t k = 0; k < 3; k++) {
+		meshCentroid[k] /= std::max(meshArea, 1e-12f);
+	}
+
+	for (std::size_t c = 0; c < clusters.size(); c++) {
+		const float* centroid = clusterData.data() + c * 6;
+		const float* normal = centroid + 3;
+		const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float sortKey = 0.0f;
+		for (std::size_t k = 0; k < 3; k++) {
+			sortKey += (centroid[k] - meshCentroid[k]) * normal[k];
+		}
+
+		clusters[c].SortKey = normalLength > 0.0f ? sortKey / normalLength : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& left, const TriangleCluster& right) {
+		return left.SortKey > right.SortKey;
+	});
+
+	std::vector<std::uint32_t> sortedIndices;
+	sortedIndices.reserve(trianglesCount * 3);
+	for (const TriangleCluster& cluster : clusters) {
+		sortedIndices.insert(sortedIndices.end(), indices + cluster.FirstTriangle * 3, indices + (cluster.FirstTriangle + cluster.TrianglesCount) * 3);
+	}
+
+	// Boundaries aren't perfect, so the order is kept only if the vertex cache doesn't suffer
+	const std::uint64_t missesCount = CountCacheMisses(indices, trianglesCount * 3, verticesCount);
+	const std::uint64_t sortedMissesCount = CountCacheMisses(sortedIndices.data(), sortedIndices.size(), verticesCount);
+	if (static_cast<double>(sortedMissesCount) <= static_cast<double>(missesCount) * OverdrawThreshold) {
+		std::memcpy(indices, sortedIndices.data(), sortedIndices.size() * sizeof(std::uint32_t));
+	}
+}
+
+void
+MeshOptimizationStats::append(const MeshOptimizationStats& stats)
+{
+	TrianglesCount += stats.TrianglesCount;
+	VerticesBefore += stats.VerticesBefore;
+	VerticesAfter += stats.VerticesAfter;
+	CacheMissesBefore += stats.CacheMissesBefore;
+	CacheMissesAfter += stats.CacheMissesAfter;
+	BufferBytesBefore += stats.BufferBytesBefore;
+	BufferBytesAfter += stats.BufferBytesAfter;
+}
+
+std::uint64_t
+MeshOptimizer::GetCacheMissesCount(const std::uint16_t* indices, std::size_t indicesCount, std::size_t verticesCount)
+{
+	std::vector<std::uint32_t> wideIndices(indices, indices + indicesCount);
+	return CountCacheMisses(wideIndices.data(), wideIndices.size(), verticesCount);
+}
+
+static float
+ReadVertexFloat(const SolidVertexBufferView& vertexBuffer, std::uint32_t vertexIndex, std::size_t byteOffset)
+{
+	std::uint32_t word = 0;
+	std::memcpy(&word, vertexBuffer.Data + static_cast<std::size_t>(vertexIndex) * vertexBuffer.Stride + byteOffset, sizeof(word));
+	if (vertexBuffer.BigEndian) {
+		EndianSwapValue(word);
+	}
+
+	float value = 0.0f;
+	std::memcpy(&value, &word, sizeof(value));
+	return value;
+}
+
+// Packed data read as float is mostly huge, tiny or not a number
+static bool
+IsPlainFloat(float value)
+{
+	const float magnitude = std::fabs(value);
+	return magnitude == 0.0f || (std::isfinite(magnitude) && magnitude >= 1e-6f && magnitude <= 1e6f);
+}
+
+static void
+QuantizeValue(float value, float scale, float offset, std::uint16_t& outValue)
+{
+	const float quantized = scale > 0.0f ? (value - offset) / scale : 0.0f;
+	outValue = static_cast<std::uint16_t>(std::clamp(quantized + 0.5f, 0.0f, 65535.0f));
+}
+
+bool
+MeshOptimizer::OptimizeSolid(const SolidView& solid, OptimizedSolid& outSolid, MeshOptimizationStats& outStats)
+{
+	for (std::size_t i = 0; i < solid.MeshEntriesCount; i++) {
+		const SolidMeshEntry& meshEntry = solid.MeshEntries[i];
+		const SolidVertexBufferView& vertexBuffer = solid.VertexBuffers[meshEntry.VertexBufferIndex];
+		if (vertexBuffer.Stride < sizeof(float) * 3) {
+			return false;
+		}
+
+		for (std::int32_t k = 0; k < meshEntry.NumIndices; k++) {
+			if (solid.Indices[meshEntry.FirstIndex + k] >= vertexBuffer.VerticesCount) {
+				dbg::Warning("Solid \"{}\" has index out of vertex buffer. Skipping the solid...", solid.Name);
+				return false;
+			}
+		}
+	}
+
+	outSolid.NameHash = solid.Info->NameHash;
+	outSolid.VertexBuffers.resize(solid.VertexBuffers.size());
+	outSolid.MeshEntries.clear();
+	outSolid.Indices.clear();
+	outStats = {};
+
+	// Equal vertices are found by their bytes, unique vertex refers to the first source one
+	std::vector<std::vector<std::uint32_t>> uniqueIndices(solid.VertexBuffers.size());
+	std::vector<std::vector<std::uint32_t>> uniqueSources(solid.VertexBuffers.size());
+	std::vector<std::vector<float>> uniquePositions(solid.VertexBuffers.size());
+	for (std::size_t b = 0; b < solid.VertexBuffers.size(); b++) {
+		const SolidVertexBufferView& vertexBuffer = solid.VertexBuffers[b];
+		std::unordered_map<std::string_view, std::uint32_t> uniqueVertices;
+		uniqueVertices.reserve(vertexBuffer.VerticesCount);
+		uniqueIndices[b].resize(vertexBuffer.VerticesCount);
+		for (std::uint32_t i = 0; i < vertexBuffer.VerticesCount; i++) {
+			const std::string_view vertexBytes(vertexBuffer.Data + static_cast<std::size_t>(i) * vertexBuffer.Stride, vertexBuffer.Stride);
+			auto it = uniqueVertices.emplace(vertexBytes, static_cast<std::uint32_t>(uniqueSources[b].size()));
+			if (it.second) {
+				float position[3];
+				if (!vertexBuffer.getPosition(i, position)) {
+					return false;
+				}
+
+				uniqueSources[b].push_back(i);
+				uniquePositions[b].insert(uniquePositions[b].end(), position, position + 3);
+			}
+
+			uniqueIndices[b][i] = it.first->second;
+		}
+
+		outStats.VerticesBefore += vertexBuffer.VerticesCount;
+		outStats.BufferBytesBefore += static_cast<std::uint64_t>(vertexBuffer.VerticesCount) * vertexBuffer.Stride;
+	}
+
+	std::vector<std::uint32_t> entryIndices;
+	std::vector<std::uint32_t> optimizedIndices;
+	std::vector<std::uint32_t> allIndices;
+	for (std::size_t i = 0; i < solid.MeshEntriesCount; i++) {
+		const SolidMeshEntry& meshEntry = solid.MeshEntries[i];
+		const std::uint32_t bufferIndex = static_cast<std::uint32_t>(meshEntry.VertexBufferIndex);
+		const std::size_t indicesCount = static_cast<std::size_t>(meshEntry.NumIndices) / 3 * 3;
+		const std::uint16_t* sourceIndices = solid.Indices + meshEntry.FirstIndex;
+
+		outStats.TrianglesCount += indicesCount / 3;
+		outStats.CacheMissesBefore += GetCacheMissesCount(sourceIndices, indicesCount, solid.VertexBuffers[bufferIndex].VerticesCount);
+		outStats.BufferBytesBefore += indicesCount * sizeof(std::uint16_t);
+
+		entryIndices.resize(indicesCount);
+		optimizedIndices.resize(indicesCount);
+		for (std::size_t k = 0; k < indicesCount; k++) {
+			entryIndices[k] = uniqueIndices[bufferIndex][sourceIndices[k]];
+		}
+
+		OptimizeVertexCache(entryIndices.data(), indicesCount, uniqueSources[bufferIndex].size(), optimizedIndices.data());
+		OptimizeOverdraw(optimizedIndices.data(), indicesCount, uniquePositions[bufferIndex]);
+
+		outSolid.MeshEntries.push_back({ bufferIndex, static_cast<std::uint32_t>(allIndices.size()), static_cast<std::uint32_t>(indicesCount) });
+		allIndices.insert(allIndices.end(), optimizedIndices.begin(), optimizedIndices.end());
+	}
+
+	// Vertices are placed in the order of the first use, unused ones are dropped
+	std::vector<std::vector<std::uint32_t>> fetchIndices(solid.VertexBuffers.size());
+	std::vector<std::vector<std::uint32_t>> fetchSources(solid.VertexBuffers.size());
+	for (std::size_t b = 0; b < solid.VertexBuffers.size(); b++) {
+		fetchIndices[b].assign(uniqueSources[b].size(), UINT32_MAX);
+	}
+
+	outSolid.Indices.resize(allIndices.size());
+	for (const OptimizedMeshEntry& meshEntry : outSolid.MeshEntries) {
+		std::vector<std::uint32_t>& bufferFetchIndices = fetchIndices[meshEntry.VertexBufferIndex];
+		std::vector<std::uint32_t>& bufferFetchSources = fetchSources[meshEntry.VertexBufferIndex];
+		for (std::size_t k = meshEntry.FirstIndex; k < meshEntry.FirstIndex + meshEntry.IndicesCount; k++) {
+			const std::uint32_t uniqueIndex = allIndices[k];
+			if (bufferFetchIndices[uniqueIndex] == UINT32_MAX) {
+				bufferFetchIndices[uniqueIndex] = static_cast<std::uint32_t>(bufferFetchSources.size());
+				bufferFetchSources.push_back(uniqueSources[meshEntry.VertexBufferIndex][uniqueIndex]);
+			}
+
+			outSolid.Indices[k] = static_cast<std::uint16_t>(bufferFetchIndices[uniqueIndex]);
+		}
+
+		outStats.CacheMissesAfter += GetCacheMissesCount(outSolid.Indices.data() + meshEntry.FirstIndex, meshEntry.IndicesCount, bufferFetchSources.size());
+	}
+
+	for (std::size_t b = 0; b < solid.VertexBuffers.size(); b++) {
+		const SolidVertexBufferView& vertexBuffer = solid.VertexBuffers[b];
+		OptimizedVertexBuffer& optimizedBuffer = outSolid.VertexBuffers[b];
+		const std::vector<std::uint32_t>& sources = fetchSources[b];
+
+		float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (std::uint32_t source : sources) {
+			float position[3];
+			vertexBuffer.getPosition(source, position);
+			for (std::size_t k = 0; k < 3; k++) {
+				boundsMin[k] = std::min(boundsMin[k], position[k]);
+				boundsMax[k] = std::max(boundsMax[k], position[k]);
+			}
+		}
+
+		optimizedBuffer.VerticesCount = static_cast<std::uint32_t>(sources.size());
+		for (std::size_t k = 0; k < 3; k++) {
+			const float extent = sources.empty() ? 0.0f : boundsMax[k] - boundsMin[k];
+			optimizedBuffer.PositionOffset[k] = sources.empty() ? 0.0f : boundsMin[k];
+			optimizedBuffer.PositionScale[k] = extent / 65535.0f;
+		}
+
+		// Words after the position are split into float attributes and the raw ones (tail bytes are raw too)
+		std::vector<std::uint32_t> rawOffsets;
+		const std::uint32_t firstAttributeOffset = sizeof(float) * 3;
+		const std::uint32_t wordsEnd = firstAttributeOffset + (vertexBuffer.Stride - firstAttributeOffset) / 4 * 4;
+		optimizedBuffer.QuantizedAttributes.clear();
+		for (std::uint32_t offset = firstAttributeOffset; offset < wordsEnd; offset += 4) {
+			float valueMin = FLT_MAX;
+			float valueMax = -FLT_MAX;
+			bool bPlainFloats = !sources.empty();
+			for (std::size_t i = 0; i < sources.size() && bPlainFloats; i++) {
+				const float value = ReadVertexFloat(vertexBuffer, sources[i], offset);
+				bPlainFloats = IsPlainFloat(value);
+				valueMin = std::min(valueMin, value);
+				valueMax = std::max(valueMax, value);
+			}
+
+			if (bPlainFloats) {
+				optimizedBuffer.QuantizedAttributes.push_back({ offset, (valueMax - valueMin) / 65535.0f, valueMin });
+			} else {
+				rawOffsets.push_back(offset);
+			}
+		}
+
+		const std::uint32_t tailSize = vertexBuffer.Stride - wordsEnd;
+		optimizedBuffer.AttributesStride = static_cast<std::uint32_t>(rawOffsets.size() * 4) + tailSize;
+
+		const std::size_t quantizedCount = optimizedBuffer.QuantizedAttributes.size();
+		optimizedBuffer.Positions.resize(sources.size() * 4);
+		optimizedBuffer.QuantizedValues.resize(sources.size() * quantizedCount);
+		optimizedBuffer.Attributes.resize(sources.size() * optimizedBuffer.AttributesStride);
+		for (std::size_t i = 0; i < sources.size(); i++) {
+			float position[3];
+			vertexBuffer.getPosition(sources[i], position);
+			for (std::size_t k = 0; k < 3; k++) {
+				QuantizeValue(position[k], optimizedBuffer.PositionScale[k], optimizedBuffer.PositionOffset[k], optimizedBuffer.Positions[i * 4 + k]);
+			}
+
+			optimizedBuffer.Positions[i * 4 + 3] = 0;
+			for (std::size_t k = 0; k < quantizedCount; k++) {
+				const QuantizedAttribute& attribute = optimizedBuffer.QuantizedAttributes[k];
+				const float value = ReadVertexFloat(vertexBuffer, sources[i], attribute.SourceOffset);
+				QuantizeValue(value, attribute.Scale, attribute.Offset, optimizedBuffer.QuantizedValues[i * quantizedCount + k]);
+			}
+
+			const char* sourceVertex = vertexBuffer.Data + static_cast<std::size_t>(sources[i]) * vertexBuffer.Stride;
+			char* rawAttributes = optimizedBuffer.Attributes.data() + i * optimizedBuffer.AttributesStride;
+			for (std::uint32_t offset : rawOffsets) {
+				std::memcpy(rawAttributes, sourceVertex + offset, 4);
+				rawAttributes += 4;
+			}
+
+			std::memcpy(rawAttributes, sourceVertex + wordsEnd, tailSize);
+		}
+
+		outStats.VerticesAfter += sources.size();
+		outStats.BufferBytesAfter += (optimizedBuffer.Positions.size() + optimizedBuffer.QuantizedValues.size()) * sizeof(std::uint16_t) + optimizedBuffer.Attributes.size();
+	}
+
+	outStats.BufferBytesAfter += outSolid.Indices.size() * sizeof(std::uint16_t);
+	return true;
+}
+
+void
+MeshOptimizer::OptimizeSolidList(const SolidListView& solidList, std::vector<OptimizedSolid>& outSolids, MeshOptimizationStats& outStats)
+{
+	std::vector<OptimizedSolid> optimizedSolids(solidList.Solids.size());
+	std::vector<MeshOptimizationStats> solidsStats(solidList.Solids.size());
+	std::vector<std::uint8_t> solidsOptimized(solidList.Solids.size());
+	ThreadPool::ParallelFor(solidList.Solids.size(), [&](std::size_t i) {
+		solidsOptimized[i] = OptimizeSolid(solidList.Solids[i], optimizedSolids[i], solidsStats[i]);
+	});
+
+	outSolids.clear();
+	outSolids.reserve(optimizedSolids.size());
+	for (std::size_t i = 0; i < optimizedSolids.size(); i++) {
+		if (solidsOptimized[i]) {
+			outStats.append(solidsStats[i]);
+			outSolids.emplace_back(std::move(optimizedSolids[i]));
+		}
+	}
+}
+
+void
+MeshOptimizer::LogReport(const MeshOptimizationStats& stats)
+{
+	if (stats.TrianglesCount == 0) {
+		return;
+	}
+
+	const double trianglesCount = static_cast<double>(stats.TrianglesCount);
+	dbg::Log("Optimized {} triangles: ACMR {:.3f} -> {:.3f}, {} -> {} vertices, {} KB -> {} KB of buffers.",
+		stats.TrianglesCount,
+		stats.CacheMissesBefore / trianglesCount,
+		stats.CacheMissesAfter / trianglesCount,
+		stats.VerticesBefore,
+		stats.VerticesAfter,
+		stats.BufferBytesBefore / 1024,
+		stats.BufferBytesAfter / 1024
+	);
+}
+
+}
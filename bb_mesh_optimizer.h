@@ -0,0 +1,105 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+// Solids are optimized for PC GPUs after parsing (see MeshOptimizer)
+extern bool OptimizeMeshes;
+
+struct OptimizedMeshEntry
+{
+	std::uint32_t VertexBufferIndex;
+	std::uint32_t FirstIndex;
+	std::uint32_t IndicesCount;
+};
+
+// Float word of the source vertex which is quantized in the same way as positions
+struct QuantizedAttribute
+{
+	std::uint32_t SourceOffset;		// byte offset in the source vertex
+	float Scale;
+	float Offset;
+};
+
+// Positions are quantized to 16 bits in the bounds of the buffer: position = value * Scale + Offset
+struct OptimizedVertexBuffer
+{
+	std::vector<std::uint16_t> Positions;	// x, y, z, padding for every vertex
+	std::vector<QuantizedAttribute> QuantizedAttributes;
+	std::vector<std::uint16_t> QuantizedValues;	// one value of every quantized attribute for every vertex
+	std::vector<char> Attributes;			// the other words of every vertex (source layout and byte order)
+	std::uint32_t AttributesStride;
+	std::uint32_t VerticesCount;
+	float PositionScale[3];
+	float PositionOffset[3];
+};
+
+struct OptimizedSolid
+{
+	std::uint32_t NameHash;
+	std::vector<OptimizedVertexBuffer> VertexBuffers;
+	std::vector<OptimizedMeshEntry> MeshEntries;
+	std::vector<std::uint16_t> Indices;
+};
+
+struct MeshOptimizationStats
+{
+	std::uint64_t TrianglesCount = 0;
+	std::uint64_t VerticesBefore = 0;
+	std::uint64_t VerticesAfter = 0;
+	std::uint64_t CacheMissesBefore = 0;	// ACMR = cache misses / triangles
+	std::uint64_t CacheMissesAfter = 0;
+	std::uint64_t BufferBytesBefore = 0;
+	std::uint64_t BufferBytesAfter = 0;
+
+	void append(const MeshOptimizationStats& stats);
+};
+
+/*
+	Optimizes triangle lists of solids for PC GPUs:
+
+	1. Equal vertices of every vertex buffer are merged.
+	2. Triangles of every mesh entry are reordered for the post-transform vertex cache (Forsyth).
+	3. Clusters of triangles are sorted to draw outer faces first (Sander et al.), if it doesn't hurt ACMR.
+	4. Vertices are reordered by the first use, positions and float attributes are quantized to 16 bits.
+	   Vertex layout is unknown, so 32-bit words which hold plain floats in every vertex are taken
+	   as float attributes. Packed normals and colors don't look like plain floats and are copied.
+*/
+class MeshOptimizer
+{
+public:
+	// FIFO cache of this size is used to measure ACMR
+	static constexpr std::uint32_t MeasureCacheSize = 16;
+
+	static std::uint64_t GetCacheMissesCount(const std::uint16_t* indices, std::size_t indicesCount, std::size_t verticesCount);
+
+	static bool OptimizeSolid(const SolidView& solid, OptimizedSolid& outSolid, MeshOptimizationStats& outStats);
+
+	// Solids are optimized in parallel, solids which can't be optimized are skipped
+	static void OptimizeSolidList(const SolidListView& solidList, std::vector<OptimizedSolid>& outSolids, MeshOptimizationStats& outStats);
+	static void LogReport(const MeshOptimizationStats& stats);
+};
+
+// Optimized solids of the loaded solid lists by solid name hash
+extern nfr::api::binary_hash_map<OptimizedSolid> OptimizedSolidsMap;
+
+}
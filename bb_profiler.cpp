@@ -0,0 +1,112 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <mutex>
+
+namespace bb
+{
+
+static std::mutex StatsLock;
+static nfr::api::binary_hash_map<ChunkTimingStats> ChunkStatsMap;
+
+void
+ChunkProfiler::Record(std::uint32_t chunkId, std::uint64_t bytesCount, std::uint64_t elapsedTime)
+{
+	std::lock_guard<std::mutex> lock(StatsLock);
+	ChunkTimingStats& stats = ChunkStatsMap[chunkId];
+	stats.ChunkId = chunkId;
+	stats.CallsCount++;
+	stats.BytesCount += bytesCount;
+	stats.TotalTime += elapsedTime;
+	stats.MaxTime = std::max(stats.MaxTime, elapsedTime);
+}
+
+void
+ChunkProfiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(StatsLock);
+	ChunkStatsMap.clear();
+}
+
+std::vector<ChunkTimingStats>
+ChunkProfiler::GetSortedStats()
+{
+	std::vector<ChunkTimingStats> sortedStats;
+	{
+		std::lock_guard<std::mutex> lock(StatsLock);
+		sortedStats.reserve(ChunkStatsMap.size());
+		for (const auto& it : ChunkStatsMap) {
+			sortedStats.emplace_back(it.second);
+		}
+	}
+
+	std::sort(sortedStats.begin(), sortedStats.end(), [](const ChunkTimingStats& left, const ChunkTimingStats& right) {
+		return left.TotalTime > right.TotalTime;
+	});
+
+	return sortedStats;
+}
+
+void
+ChunkProfiler::LogReport()
+{
+	const std::vector<ChunkTimingStats> sortedStats = GetSortedStats();
+	if (sortedStats.empty()) {
+		return;
+	}
+
+	dbg::Log("Chunks loading statistics:");
+	dbg::Log("    {:<24} {:>8} {:>12} {:>12} {:>12} {:>10}", "chunk", "calls", "size (KB)", "total (ms)", "max (ms)", "MB/s");
+	for (const ChunkTimingStats& stats : sortedStats) {
+		const double totalSeconds = stats.TotalTime / 1e9;
+		const double throughput = totalSeconds > 0.0 ? (stats.BytesCount / (1024.0 * 1024.0)) / totalSeconds : 0.0;
+		dbg::Log("    {:<24} {:>8} {:>12} {:>12.3f} {:>12.3f} {:>10.1f}",
+			GetNFSChunkName(stats.ChunkId),
+			stats.CallsCount,
+			stats.BytesCount / 1024,
+			stats.TotalTime / 1e6,
+			stats.MaxTime / 1e6,
+			throughput
+		);
+	}
+}
+
+bool
+ChunkProfiler::WriteJsonReport(nfr::api::IStream* outFile)
+{
+	const std::vector<ChunkTimingStats> sortedStats = GetSortedStats();
+
+	std::string jsonReport = "[\n";
+	for (std::size_t i = 0; i < sortedStats.size(); i++) {
+		const ChunkTimingStats& stats = sortedStats[i];
+		jsonReport += "\t{ \"id\": " + std::to_string(stats.ChunkId);
+		jsonReport += ", \"name\": \"" + std::string(GetNFSChunkName(stats.ChunkId)) + "\"";
+		jsonReport += ", \"calls\": " + std::to_string(stats.CallsCount);
+		jsonReport += ", \"bytes\": " + std::to_string(stats.BytesCount);
+		jsonReport += ", \"total_ns\": " + std::to_string(stats.TotalTime);
+		jsonReport += ", \"max_ns\": " + std::to_string(stats.MaxTime);
+		jsonReport += (i + 1 < sortedStats.size()) ? " },\n" : " }\n";
+	}
+
+	jsonReport += "]\n";
+	return outFile->write(jsonReport.data(), jsonReport.size()) == static_cast<std::int64_t>(jsonReport.size());
+}
+
+}
@@ -0,0 +1,68 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+#include <chrono>
+
+namespace bb
+{
+
+struct ChunkTimingStats
+{
+	std::uint32_t ChunkId;
+	std::uint64_t CallsCount;
+	std::uint64_t BytesCount;
+	std::uint64_t TotalTime;	// nanoseconds
+	std::uint64_t MaxTime;		// nanoseconds
+};
+
+class ChunkProfiler
+{
+public:
+	static void Record(std::uint32_t chunkId, std::uint64_t bytesCount, std::uint64_t elapsedTime);
+	static void Reset();
+
+	// Sorted by total time, the most expensive chunk types first
+	static std::vector<ChunkTimingStats> GetSortedStats();
+
+	static void LogReport();
+	static bool WriteJsonReport(nfr::api::IStream* outFile);
+};
+
+// Measures the time spent in the scope for the passed chunk. Nested scopes
+// are counted separately, so parent chunk timings include their children.
+class ChunkProfileScope
+{
+private:
+	std::uint32_t chunkId;
+	std::uint64_t bytesCount;
+	std::chrono::steady_clock::time_point startTime;
+
+public:
+	ChunkProfileScope(const aChunk* chunkData)
+		: chunkId(chunkData->Id), bytesCount(chunkData->getSize()), startTime(std::chrono::steady_clock::now()) {}
+
+	~ChunkProfileScope()
+	{
+		const auto elapsedTime = std::chrono::steady_clock::now() - startTime;
+		ChunkProfiler::Record(chunkId, bytesCount, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsedTime).count());
+	}
+};
+
+}
@@ -0,0 +1,185 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <cfloat>
+#include <cmath>
+
+namespace bb
+{
+
+static std::vector<SceneryOverrideInfo> SceneryOverrides;
+
+SceneryFrustum
+SceneryFrustum::FromViewProjection(const float viewProjection[16])
+{
+	const float* rows[4] = { viewProjection, viewProjection + 4, viewProjection + 8, viewProjection + 12 };
+	SceneryFrustum frustum = {};
+	for (std::size_t k = 0; k < 4; k++) {
+		frustum.Planes[0][k] = rows[3][k] + rows[0][k];	// left
+		frustum.Planes[1][k] = rows[3][k] - rows[0][k];	// right
+		frustum.Planes[2][k] = rows[3][k] + rows[1][k];	// bottom
+		frustum.Planes[3][k] = rows[3][k] - rows[1][k];	// top
+		frustum.Planes[4][k] = rows[2][k];					// near
+		frustum.Planes[5][k] = rows[3][k] - rows[2][k];	// far
+	}
+
+	for (float* plane : frustum.Planes) {
+		const float normalLength = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (normalLength > 0.0f) {
+			for (std::size_t k = 0; k < 4; k++) {
+				plane[k] /= normalLength;
+			}
+		}
+	}
+
+	return frustum;
+}
+
+std::uint32_t
+SceneryBVH::buildNode(std::uint32_t firstInstance, std::uint32_t instancesCount, std::uint32_t depth)
+{
+	const std::uint32_t nodeIndex = static_cast<std::uint32_t>(nodes.size());
+	SceneryBVHNode node = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX }, firstInstance, instancesCount };
+	float centroidsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float centroidsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (std::uint32_t i = firstInstance; i < firstInstance + instancesCount; i++) {
+		const SceneryInstanceEntry& instance = instances[i];
+		for (std::size_t k = 0; k < 3; k++) {
+			const float centroid = (instance.BoundsMin[k] + instance.BoundsMax[k]) * 0.5f;
+			node.BoundsMin[k] = std::min(node.BoundsMin[k], instance.BoundsMin[k]);
+			node.BoundsMax[k] = std::max(node.BoundsMax[k], instance.BoundsMax[k]);
+			centroidsMin[k] = std::min(centroidsMin[k], centroid);
+			centroidsMax[k] = std::max(centroidsMax[k], centroid);
+		}
+	}
+
+	nodes.push_back(node);
+
+	// Median split always halves the range, so the depth is limited by log2 of instances count
+	if (instancesCount <= MaxLeafInstances || depth + 2 >= MaxDepth) {
+		return nodeIndex;
+	}
+
+	std::size_t splitAxis = 0;
+	for (std::size_t k = 1; k < 3; k++) {
+		if (centroidsMax[k] - centroidsMin[k] > centroidsMax[splitAxis] - centroidsMin[splitAxis]) {
+			splitAxis = k;
+		}
+	}
+
+	const std::uint32_t leftCount = instancesCount / 2;
+	auto firstIt = instances.begin() + firstInstance;
+	std::nth_element(firstIt, firstIt + leftCount, firstIt + instancesCount, [splitAxis](const SceneryInstanceEntry& left, const SceneryInstanceEntry& right) {
+		return left.BoundsMin[splitAxis] + left.BoundsMax[splitAxis] < right.BoundsMin[splitAxis] + right.BoundsMax[splitAxis];
+	});
+
+	buildNode(firstInstance, leftCount, depth + 1);
+	const std::uint32_t rightIndex = buildNode(firstInstance + leftCount, instancesCount - leftCount, depth + 1);
+	nodes[nodeIndex].Offset = rightIndex;
+	nodes[nodeIndex].InstancesCount = 0;
+	return nodeIndex;
+}
+
+void
+SceneryBVH::build(std::vector<SceneryInstanceEntry>&& inInstances)
+{
+	instances = std::move(inInstances);
+	nodes.clear();
+	instanceSlots.clear();
+	if (instances.empty()) {
+		return;
+	}
+
+	nodes.reserve(instances.size() * 2);
+	buildNode(0, static_cast<std::uint32_t>(instances.size()), 0);
+
+	std::uint16_t maxInstanceNumber = 0;
+	for (const SceneryInstanceEntry& instance : instances) {
+		maxInstanceNumber = std::max(maxInstanceNumber, instance.InstanceNumber);
+	}
+
+	instanceSlots.assign(static_cast<std::size_t>(maxInstanceNumber) + 1, UINT32_MAX);
+	for (std::size_t i = 0; i < instances.size(); i++) {
+		instanceSlots[instances[i].InstanceNumber] = static_cast<std::uint32_t>(i);
+	}
+}
+
+bool
+SceneryBVH::applyOverride(std::uint16_t instanceNumber, std::uint16_t excludeFlags)
+{
+	if (instanceNumber >= instanceSlots.size() || instanceSlots[instanceNumber] == UINT32_MAX) {
+		return false;
+	}
+
+	instances[instanceSlots[instanceNumber]].ExcludeFlags = excludeFlags;
+	return true;
+}
+
+void
+RegisterScenerySection(SceneryBVH&& sceneryBVH)
+{
+	for (const SceneryOverrideInfo& overrideInfo : SceneryOverrides) {
+		if (overrideInfo.SectionNumber == sceneryBVH.getSectionNumber()) {
+			sceneryBVH.applyOverride(static_cast<std::uint16_t>(overrideInfo.InstanceNumber), overrideInfo.ExcludeFlags);
+		}
+	}
+
+	const std::uint32_t sectionKey = static_cast<std::uint32_t>(sceneryBVH.getSectionNumber());
+	ScenerySectionsMap.insert_or_assign(sectionKey, std::move(sceneryBVH));
+}
+
+void
+ApplySceneryOverride(const SceneryOverrideInfo& overrideInfo)
+{
+	SceneryOverrides.push_back(overrideInfo);
+	auto it = ScenerySectionsMap.find(static_cast<std::uint32_t>(overrideInfo.SectionNumber));
+	if (it != ScenerySectionsMap.end()) {
+		it->second.applyOverride(static_cast<std::uint16_t>(overrideInfo.InstanceNumber), overrideInfo.ExcludeFlags);
+	}
+}
+
+void
+QueryScenerySections(const float center[3], float radius, std::vector<std::int32_t>& outSectionNumbers)
+{
+	std::vector<std::pair<float, std::int32_t>> foundSections;
+	for (const auto& [sectionKey, sceneryBVH] : ScenerySectionsMap) {
+		if (!sceneryBVH.overlapsRadius(center, radius)) {
+			continue;
+		}
+
+		const SceneryBVHNode& rootNode = sceneryBVH.getNodes()[0];
+		float distanceSquared = 0.0f;
+		for (std::size_t k = 0; k < 3; k++) {
+			const float delta = std::max(std::max(rootNode.BoundsMin[k] - center[k], center[k] - rootNode.BoundsMax[k]), 0.0f);
+			distanceSquared += delta * delta;
+		}
+
+		foundSections.emplace_back(distanceSquared, sceneryBVH.getSectionNumber());
+	}
+
+	std::sort(foundSections.begin(), foundSections.end());
+	outSectionNumbers.clear();
+	outSectionNumbers.reserve(foundSections.size());
+	for (const auto& [distanceSquared, sectionNumber] : foundSections) {
+		outSectionNumbers.push_back(sectionNumber);
+	}
+}
+
+}
@@ -0,0 +1,224 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+// Planes point inside: a point is visible if Normal * point + Distance >= 0 for every plane
+struct SceneryFrustum
+{
+	float Planes[6][4];	// normal x, y, z, distance
+
+	// Planes of the row-major view-projection matrix (clip = matrix * point, D3D depth range)
+	static SceneryFrustum FromViewProjection(const float viewProjection[16]);
+};
+
+// Scenery instance copied out of the section chunk, instances are stored in the order of BVH leaves
+struct SceneryInstanceEntry
+{
+	float BoundsMin[3];
+	float BoundsMax[3];
+	float Position[3];
+	std::uint32_t SolidNameHash;	// the most detailed LOD, 0 if scenery info is missing
+	std::uint16_t InstanceNumber;	// index in the section chunk (overrides refer to it)
+	std::uint16_t ExcludeFlags;
+};
+
+// Nodes are stored depth first, so the left child of the parent always follows it
+struct SceneryBVHNode
+{
+	float BoundsMin[3];
+	float BoundsMax[3];
+	std::uint32_t Offset;			// right child for parents, first instance for leaves
+	std::uint32_t InstancesCount;	// 0 for parents
+};
+
+class SceneryBVH
+{
+public:
+	static constexpr std::uint32_t MaxLeafInstances = 4;
+	static constexpr std::uint32_t MaxDepth = 64;
+
+private:
+	std::int32_t sectionNumber = -1;
+	std::vector<SceneryBVHNode> nodes;
+	std::vector<SceneryInstanceEntry> instances;
+	std::vector<std::uint32_t> instanceSlots;	// instance number -> index in instances
+
+	std::uint32_t buildNode(std::uint32_t firstInstance, std::uint32_t instancesCount, std::uint32_t depth);
+
+	static bool
+	overlapsSphere(const float boundsMin[3], const float boundsMax[3], const float center[3], float radiusSquared)
+	{
+		float distanceSquared = 0.0f;
+		for (std::size_t k = 0; k < 3; k++) {
+			const float delta = std::max(std::max(boundsMin[k] - center[k], center[k] - boundsMax[k]), 0.0f);
+			distanceSquared += delta * delta;
+		}
+
+		return distanceSquared <= radiusSquared;
+	}
+
+	// Planes which fully contain the box are removed from the mask, children don't test them again
+	static bool
+	overlapsFrustum(const float boundsMin[3], const float boundsMax[3], const SceneryFrustum& frustum, std::uint32_t& planesMask)
+	{
+		for (std::uint32_t i = 0; i < 6; i++) {
+			if (!(planesMask & (1u << i))) {
+				continue;
+			}
+
+			const float* plane = frustum.Planes[i];
+			float farDistance = plane[3];
+			float nearDistance = plane[3];
+			for (std::size_t k = 0; k < 3; k++) {
+				farDistance += plane[k] * (plane[k] >= 0.0f ? boundsMax[k] : boundsMin[k]);
+				nearDistance += plane[k] * (plane[k] >= 0.0f ? boundsMin[k] : boundsMax[k]);
+			}
+
+			if (farDistance < 0.0f) {
+				return false;
+			}
+
+			if (nearDistance >= 0.0f) {
+				planesMask &= ~(1u << i);
+			}
+		}
+
+		return true;
+	}
+
+public:
+	SceneryBVH() = default;
+	SceneryBVH(std::int32_t inSectionNumber) : sectionNumber(inSectionNumber) {}
+
+	void build(std::vector<SceneryInstanceEntry>&& inInstances);
+	bool applyOverride(std::uint16_t instanceNumber, std::uint16_t excludeFlags);
+
+	std::int32_t getSectionNumber() const { return sectionNumber; }
+	const std::vector<SceneryBVHNode>& getNodes() const { return nodes; }
+	const std::vector<SceneryInstanceEntry>& getInstances() const { return instances; }
+
+	bool isEmpty() const { return nodes.empty(); }
+	bool overlapsRadius(const float center[3], float radius) const
+	{
+		return !nodes.empty() && overlapsSphere(nodes[0].BoundsMin, nodes[0].BoundsMax, center, radius * radius);
+	}
+
+	// Calls visitor(const SceneryInstanceEntry&) for every instance with bounds inside the sphere,
+	// instances with any of excludeMask flags are skipped
+	template<typename Visitor>
+	void queryRadius(const float center[3], float radius, std::uint16_t excludeMask, Visitor&& visitor) const
+	{
+		if (nodes.empty()) {
+			return;
+		}
+
+		const float radiusSquared = radius * radius;
+		std::uint32_t stack[MaxDepth];
+		std::uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize != 0) {
+			const SceneryBVHNode& node = nodes[stack[--stackSize]];
+			if (!overlapsSphere(node.BoundsMin, node.BoundsMax, center, radiusSquared)) {
+				continue;
+			}
+
+			if (node.InstancesCount == 0) {
+				stack[stackSize++] = node.Offset;
+				stack[stackSize++] = static_cast<std::uint32_t>(&node - nodes.data()) + 1;
+				continue;
+			}
+
+			for (std::uint32_t i = node.Offset; i < node.Offset + node.InstancesCount; i++) {
+				const SceneryInstanceEntry& instance = instances[i];
+				if (!(instance.ExcludeFlags & excludeMask) && overlapsSphere(instance.BoundsMin, instance.BoundsMax, center, radiusSquared)) {
+					visitor(instance);
+				}
+			}
+		}
+	}
+
+	// Calls visitor(const SceneryInstanceEntry&) for every instance with bounds intersecting the frustum,
+	// instances with any of excludeMask flags are skipped
+	template<typename Visitor>
+	void queryFrustum(const SceneryFrustum& frustum, std::uint16_t excludeMask, Visitor&& visitor) const
+	{
+		if (nodes.empty()) {
+			return;
+		}
+
+		std::uint32_t stack[MaxDepth];
+		std::uint32_t masksStack[MaxDepth];
+		std::uint32_t stackSize = 0;
+		stack[stackSize] = 0;
+		masksStack[stackSize++] = 0x3F;
+		while (stackSize != 0) {
+			stackSize--;
+			const SceneryBVHNode& node = nodes[stack[stackSize]];
+			std::uint32_t planesMask = masksStack[stackSize];
+			if (!overlapsFrustum(node.BoundsMin, node.BoundsMax, frustum, planesMask)) {
+				continue;
+			}
+
+			if (node.InstancesCount == 0) {
+				stack[stackSize] = node.Offset;
+				masksStack[stackSize++] = planesMask;
+				stack[stackSize] = static_cast<std::uint32_t>(&node - nodes.data()) + 1;
+				masksStack[stackSize++] = planesMask;
+				continue;
+			}
+
+			for (std::uint32_t i = node.Offset; i < node.Offset + node.InstancesCount; i++) {
+				const SceneryInstanceEntry& instance = instances[i];
+				std::uint32_t instancePlanesMask = planesMask;
+				if (!(instance.ExcludeFlags & excludeMask) && overlapsFrustum(instance.BoundsMin, instance.BoundsMax, frustum, instancePlanesMask)) {
+					visitor(instance);
+				}
+			}
+		}
+	}
+};
+
+// Named set of scenery overrides which is switched on and off by the game
+struct SceneryGroupEntry
+{
+	std::int16_t GroupNumber;
+	bool DriveThroughBarrier;
+	bool InitiallyEnabled;
+	std::vector<std::uint16_t> OverrideInfoNumbers;	// indices in the SceneryOverride chunk
+};
+
+// Scenery sections by their numbers (LightPack::ScenerySectionNumber uses the same numbering)
+extern nfr::api::binary_hash_map<SceneryBVH> ScenerySectionsMap;
+extern nfr::api::binary_hash_map<SceneryGroupEntry> SceneryGroupsMap;	// by name hash
+extern nfr::api::binary_hash_map<TrackInfo> TracksMap;					// by track number
+
+// Replaces the loaded section, known overrides are applied to it
+void RegisterScenerySection(SceneryBVH&& sceneryBVH);
+
+// Overrides are kept, so they are applied to sections which are loaded later too
+void ApplySceneryOverride(const SceneryOverrideInfo& overrideInfo);
+
+// Sections with bounds inside the sphere, the nearest first. Used to stream sections around the player.
+void QueryScenerySections(const float center[3], float radius, std::vector<std::int32_t>& outSectionNumbers);
+
+}
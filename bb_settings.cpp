@@ -0,0 +1,121 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+
+namespace bb
+{
+
+static std::string_view
+TrimSetting(std::string_view value)
+{
+	const std::size_t begin = value.find_first_not_of(" \t\r");
+	if (begin == std::string_view::npos) {
+		return {};
+	}
+
+	const std::size_t end = value.find_last_not_of(" \t\r");
+	return value.substr(begin, end - begin + 1);
+}
+
+static bool
+ParseBoolSetting(std::string_view value, bool& outValue)
+{
+	if (value == "true" || value == "1") {
+		outValue = true;
+		return true;
+	}
+
+	if (value == "false" || value == "0") {
+		outValue = false;
+		return true;
+	}
+
+	return false;
+}
+
+bool
+ApplySetting(std::string_view key, std::string_view value)
+{
+	bool bParsed = false;
+	if (key == "TextureOutputMode") {
+		if (value == "Files") {
+			TextureOutputMode = ETextureOutputMode::Files;
+			bParsed = true;
+		} else if (value == "Archive") {
+			TextureOutputMode = ETextureOutputMode::Archive;
+			bParsed = true;
+		}
+	} else if (key == "GenerateMissingMipLevels") {
+		bParsed = ParseBoolSetting(value, GenerateMissingMipLevels);
+	} else if (key == "PackUITextureAtlases") {
+		bParsed = ParseBoolSetting(value, PackUITextureAtlases);
+	} else if (key == "OptimizeMeshes") {
+		bParsed = ParseBoolSetting(value, OptimizeMeshes);
+	} else {
+		dbg::Warning("Unknown setting \"{}\".", key);
+		return false;
+	}
+
+	if (!bParsed) {
+		dbg::Warning("Invalid value \"{}\" of setting \"{}\".", value, key);
+		return false;
+	}
+
+	dbg::Verbose("Setting \"{}\" is set to \"{}\".", key, value);
+	return true;
+}
+
+bool
+LoadSettings(const nfr::api::path& filePath)
+{
+	nfr::api::SafeInterface<nfr::api::IStream> stream = EngineFactory->openFile(nfr::api::EStreamFlags::ReadFlag, filePath);
+	if (!stream->isOpen()) {
+		dbg::Warning("Can't open settings file \"{}\".", filePath.generic_string());
+		return false;
+	}
+
+	dbg::Log("Loading settings from \"{}\"...", filePath.generic_string());
+
+	std::string readedLine;
+	while (stream->getLine(readedLine)) {
+		std::string_view line = readedLine;
+		const std::size_t commentPos = line.find('#');
+		if (commentPos != std::string_view::npos) {
+			line = line.substr(0, commentPos);
+		}
+
+		line = TrimSetting(line);
+		if (line.empty()) {
+			continue;
+		}
+
+		const std::size_t separatorPos = line.find('=');
+		if (separatorPos == std::string_view::npos) {
+			dbg::Warning("Invalid line \"{}\" in settings file. Skipping the line...", line);
+			continue;
+		}
+
+		ApplySetting(TrimSetting(line.substr(0, separatorPos)), TrimSetting(line.substr(separatorPos + 1)));
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,41 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+/*
+	Conversion settings are read from "blackbox.cfg" in the game directory, one "Key = Value"
+	pair per line, lines starting with '#' are comments:
+
+	TextureOutputMode = Files			# Files or Archive
+	GenerateMissingMipLevels = true		# true or false
+	PackUITextureAtlases = false		# true or false
+	OptimizeMeshes = false				# true or false
+
+	The values above are the defaults, missing keys keep them.
+*/
+constexpr const char* SettingsFileName = "blackbox.cfg";
+
+bool ApplySetting(std::string_view key, std::string_view value);
+bool LoadSettings(const nfr::api::path& filePath);
+
+}
@@ -23,9 +23,11 @@
 #ifdef _WIN32
 #define BYTESWAP_SHORT(x) _byteswap_ushort(x)
 #define BYTESWAP_LONG(x) _byteswap_ulong(x)
+#define BYTESWAP_LONGLONG(x) _byteswap_uint64(x)
 #else
 #define BYTESWAP_SHORT(x) __builtin_bswap16(x)
 #define BYTESWAP_LONG(x) __builtin_bswap32(x)
+#define BYTESWAP_LONGLONG(x) __builtin_bswap64(x)
 #endif
 
 #define ALIGN_VALUE(x, align)  ((x + (align-1)) & (~(align-1)))
@@ -43,6 +45,9 @@ enum class ENFSChunkId : std::uint32_t
 	PresetSkins = 0x00030250, // 0x08 Actual
 	Smokeables = 0x00034026, // 0x10 Modular
 	WorldBounds = 0x00034027, // varies
+	ScenerySectionHeader = 0x00034101, // varies
+	SceneryInfo = 0x00034102, // varies
+	SceneryInstance = 0x00034103, // 0x10 Modular
 	SceneryOverride = 0x00034107, // 0x10 Modular
 	SceneryGroup = 0x00034108, // 0x10 Modular
 	TrackPosMarkers = 0x00034146, // varies
@@ -121,6 +126,14 @@ enum class ENFSChunkId : std::uint32_t
 	SkinRegionDB = 0x0003CE12, // 0x10 Modular
 	VinylMetaData = 0x0003CE13, // 0x10 Modular
 	FX = 0x000B5846, // not supported
+	SolidListInfo = 0x00134002, // varies
+	SolidListIndex = 0x00134003, // varies
+	SolidInfo = 0x00134011, // varies
+	SolidTextures = 0x00134012, // varies
+	SolidMeshInfo = 0x00134900, // varies
+	SolidVertexBuffer = 0x00134B01, // 0x80 Modular
+	SolidMeshEntries = 0x00134B02, // varies
+	SolidIndexBuffer = 0x00134B03, // varies
 	Materials = 0x00135200, // 0x10 Modular
 	EAGLSkeleton = 0x00E34009, // varies
 	EAGLAnimations = 0x00E34010, // varies
@@ -173,6 +186,7 @@ enum class ENFSChunkId : std::uint32_t
 	Geometry = 0x80134000, // varies
 	GeometryHeader = 0x80134001, // varies
 	GeometryData = 0x80134010, // varies
+	SolidMesh = 0x80134100, // varies
 	ELights = 0x80135000, // varies
 	LightPack = 0x00135001,
 	AABBTree = 0x00135002,
@@ -186,6 +200,76 @@ enum class ENFSChunkId : std::uint32_t
 	TPK_DataBlock = 0xB3320000, // 0x80 Modular
 };
 
+// Chunks marked "Modular" above have their data aligned by 0x11 padding words, 0 if the alignment varies
+constexpr std::size_t
+GetNFSChunkAlignment(ENFSChunkId chunkId)
+{
+	switch (chunkId) {
+	case ENFSChunkId::FEFont:
+	case ENFSChunkId::FEPackage:
+	case ENFSChunkId::FNGCompress:
+	case ENFSChunkId::PresetRides:
+	case ENFSChunkId::MagazinesFrontend:
+	case ENFSChunkId::MagazinesShowcase:
+	case ENFSChunkId::WideDecals:
+	case ENFSChunkId::Smokeables:
+	case ENFSChunkId::SceneryInstance:
+	case ENFSChunkId::SceneryOverride:
+	case ENFSChunkId::SceneryGroup:
+	case ENFSChunkId::Tracks:
+	case ENFSChunkId::CarTypeInfos:
+	case ENFSChunkId::CarSkins:
+	case ENFSChunkId::CarInfoAnimHookup:
+	case ENFSChunkId::GCareer_Styles:
+	case ENFSChunkId::STRBlocks:
+	case ENFSChunkId::LangFont:
+	case ENFSChunkId::Subtitles:
+	case ENFSChunkId::CompTPKBlock:
+	case ENFSChunkId::Collision:
+	case ENFSChunkId::SkinRegionDB:
+	case ENFSChunkId::VinylMetaData:
+	case ENFSChunkId::Materials:
+	case ENFSChunkId::ColorCube:
+	case ENFSChunkId::AnimDirectory:
+	case ENFSChunkId::IceCameraPart0:
+	case ENFSChunkId::IceCameraPart1:
+	case ENFSChunkId::IceCameraPart2:
+	case ENFSChunkId::IceCameraPart3:
+	case ENFSChunkId::IceCameraPart4:
+	case ENFSChunkId::IceSettings:
+	case ENFSChunkId::SoundStichs:
+	case ENFSChunkId::VinylDataTable:
+		return 0x10;
+	case ENFSChunkId::TPK_InfoBlock:
+		return 0x40;
+	case ENFSChunkId::StyleMomentsInfo:
+	case ENFSChunkId::StylePartitions:
+	case ENFSChunkId::DifficultyInfo:
+	case ENFSChunkId::AcidEffects:
+	case ENFSChunkId::AcidEmitters:
+	case ENFSChunkId::MovieCatalog:
+	case ENFSChunkId::ICECatalog:
+	case ENFSChunkId::TPKSettings:
+	case ENFSChunkId::SolidVertexBuffer:
+	case ENFSChunkId::DDSTexture:
+	case ENFSChunkId::PCAWater0:
+	case ENFSChunkId::TPK_DataPart2:
+	case ENFSChunkId::GCareer_Old:
+	case ENFSChunkId::GCareer:
+	case ENFSChunkId::GLimitations:
+	case ENFSChunkId::SpecialEffects:
+	case ENFSChunkId::PCAWeights:
+	case ENFSChunkId::TPK_Blocks:
+	case ENFSChunkId::TPK_DataBlock:
+		return 0x80;
+	case ENFSChunkId::WCollisionRaww:
+	case ENFSChunkId::VinylSystem:
+		return 0x800;
+	default:
+		return 0;
+	}
+}
+
 class TexturePack;
 
 struct RenderState
@@ -231,6 +315,158 @@ struct SolidListHeader
 	//bPList<eTextureEntry> DefaultTextureList;
 };
 
+struct SolidIndexEntry
+{
+	std::uint32_t NameHash;
+	std::uint32_t Padding;
+	//eSolid* pSolid;
+};
+
+struct SolidInfo
+{
+	char BigPadding[8];
+	std::uint8_t Version;
+	std::uint8_t EndianSwapped;
+	std::uint16_t Flags;
+	std::uint32_t NameHash;
+	std::int16_t NumPolys;
+	std::int16_t NumVerts;
+	std::int8_t NumBones;
+	std::int8_t NumTextureTableEntries;
+	std::int8_t NumLightMaterials;
+	std::int8_t NumPositionMarkerTableEntries;
+	std::int32_t ReferencedFrameCounter;
+	float AABBMinX;
+	float AABBMinY;
+	float AABBMinZ;
+	std::uint32_t Padding0;
+	float AABBMaxX;
+	float AABBMaxY;
+	float AABBMaxZ;
+	std::uint32_t Padding1;
+	float PivotMatrix[16];
+
+	char AnotherBigPadding[16];
+	//PositionMarker* pPositionMarkerTable;
+	//eNormalSmoother* pNormalSmoother;
+	//eDamageVertex* DamageVertexTable;
+	float Volume;
+	float Density;
+	// char Name[] follows the structure (up to the end of chunk)
+};
+
+struct SolidTextureEntry
+{
+	std::uint32_t NameHash;
+	std::uint32_t Padding;
+};
+
+struct SolidMeshInfo
+{
+	char BigPadding[12];
+	std::uint32_t Flags;
+	std::uint32_t NumMeshEntries;
+	std::uint32_t NumVertexBuffers;
+	std::uint32_t NumIndices;
+
+	char AnotherBigPadding[16];
+};
+
+// One draw of the solid: vertices range of one vertex buffer and indices range of the index buffer
+struct SolidMeshEntry
+{
+	float BoundsMin[3];
+	float BoundsMax[3];
+	std::uint8_t TextureIndices[5];		// indices in solid textures table (0xFF - unused)
+	std::uint8_t ShaderIndex;
+	std::uint16_t Padding;
+	std::uint32_t Flags;
+	std::int32_t VertexBufferIndex;
+	std::int32_t NumVertices;
+	std::int32_t FirstIndex;
+	std::int32_t NumIndices;
+
+	char BigPadding[12];
+};
+
+struct ScenerySectionHeader
+{
+	char BigPadding[8];
+	std::int32_t ChunksLoaded;
+	char DebugName[24];
+	std::int32_t SectionNumber;
+	//SceneryInfo* pSceneryInfo;
+	//SceneryInstance* pSceneryInstance;
+	//... (pointers and counts are fixed up by the game)
+};
+
+struct SceneryInfo
+{
+	char DebugName[24];
+	std::uint32_t SolidMeshKey[3];		// LODs, the most detailed first
+
+	char BigPadding[12];
+	//eSolid* pSolid[3];
+	std::uint16_t SceneryFlags;
+	std::int16_t Padding;
+	float Radius;
+	std::uint32_t HierarchyKey;
+
+	char AnotherBigPadding[12];
+};
+
+struct SceneryInstance
+{
+	float BBoxMin[3];
+	float BBoxMax[3];
+	std::uint16_t ExcludeFlags;
+	std::int16_t PrecullerInfoIndex;
+	std::int16_t LightingContextNumber;
+	std::int16_t SceneryInfoNumber;
+	float Position[3];
+	std::int16_t Rotation[9];			// 3x3 matrix in 2.14 fixed point
+	std::int16_t Padding;
+};
+
+struct SceneryOverrideInfo
+{
+	std::int16_t SectionNumber;
+	std::int16_t InstanceNumber;
+	std::uint16_t ExcludeFlags;
+	std::int16_t Padding;
+};
+
+struct SceneryGroupHeader
+{
+	char BigPadding[8];
+	std::uint32_t NameHash;
+	std::int16_t GroupNumber;
+	std::int16_t OverridesCount;
+	std::uint8_t DriveThroughBarrier;
+	std::uint8_t InitiallyEnabled;
+	std::int16_t Padding;
+	//std::uint16_t OverrideInfoNumbers[OverridesCount];	(the group is aligned to 4 bytes)
+};
+
+struct TrackInfo
+{
+	char Name[8];
+	char TrackDirectory[32];
+	char RegionName[8];
+	char RegionDirectory[32];
+	std::int32_t LocationNumber;
+	char LocationDirectory[16];
+	std::int32_t LocationType;
+	char DriftType[16];
+	std::int16_t TrackNumber;
+	std::int16_t SameAsTrackNumber;
+	std::uint32_t SunInfoNameHash;
+	std::uint32_t UsageFlags;
+
+	char BigPadding[156];
+	//... (track map calibration, race length, time of day and difficulty are not used)
+};
+
 struct TexturePlatInfo
 {
 	char BigPadding[8];
@@ -339,6 +575,13 @@ struct TextureAnim
 	//TextureAnimEntry* TextureAnimTable;
 };
 
+struct TextureAnimEntry
+{
+	std::uint32_t NameHash;
+	std::uint32_t Padding;
+	//TextureInfo* pTextureInfo;
+};
+
 
 struct TextureVRAMDataHeader
 {
@@ -432,20 +675,6 @@ struct OldEngineFont
 	std::int32_t KernTbl;
 	std::int32_t Shape;
 	std::int32_t States[MAX_FONT_STATES];
-
-	void EndianSwap()
-	{
-		Size = BYTESWAP_LONG(Size);
-		Version = BYTESWAP_SHORT(Version);
-		Num = BYTESWAP_SHORT(Num);
-		Flags = BYTESWAP_SHORT(Flags);
-		GlyphTbl = BYTESWAP_LONG(GlyphTbl);
-		KernTbl = BYTESWAP_LONG(KernTbl);
-		Shape = BYTESWAP_LONG(Shape);
-		for (std::int32_t& state : States) {
-			state = BYTESWAP_LONG(state);
-		}
-	}
 };
 
 struct EngineFont
@@ -0,0 +1,71 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+
+namespace bb
+{
+
+bool
+TextureAnimationTable::addAnimation(const TextureAnim& textureAnim, const TextureAnimEntry* animEntries, std::size_t animEntriesCount)
+{
+	if (textureAnim.NumFrames <= 0 || animEntriesCount < static_cast<std::size_t>(textureAnim.NumFrames)) {
+		return false;
+	}
+
+	TextureAnimation animation = {};
+	animation.NameHash = textureAnim.NameHash;
+	animation.FirstFrame = static_cast<std::uint32_t>(frames.size());
+	animation.FramesCount = static_cast<std::uint16_t>(textureAnim.NumFrames);
+	animation.FramesPerSecond = static_cast<std::uint8_t>(textureAnim.FramesPerSecond);
+	animation.TimeBase = textureAnim.TimeBase;
+
+	for (std::size_t i = 0; i < animation.FramesCount; i++) {
+		frames.push_back(animEntries[i].NameHash);
+	}
+
+	auto it = std::lower_bound(animations.begin(), animations.end(), animation.NameHash, [](const TextureAnimation& left, std::uint32_t nameHash) {
+		return left.NameHash < nameHash;
+	});
+
+	// Frames of the replaced animation stay in the table, animations are never replaced in valid packs
+	if (it != animations.end() && it->NameHash == animation.NameHash) {
+		*it = animation;
+	} else {
+		animations.insert(it, animation);
+	}
+
+	return true;
+}
+
+const TextureAnimation*
+TextureAnimationTable::find(std::uint32_t nameHash) const
+{
+	auto it = std::lower_bound(animations.begin(), animations.end(), nameHash, [](const TextureAnimation& left, std::uint32_t nameHash) {
+		return left.NameHash < nameHash;
+	});
+
+	if (it == animations.end() || it->NameHash != nameHash) {
+		return nullptr;
+	}
+
+	return &(*it);
+}
+
+}
@@ -0,0 +1,69 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+struct TextureAnimation
+{
+	std::uint32_t NameHash;
+	std::uint32_t FirstFrame;		// index of the first frame in the frames table
+	std::uint16_t FramesCount;
+	std::uint8_t FramesPerSecond;
+	std::int8_t TimeBase;			// frame which is shown at the animation start
+};
+
+// Animated textures of one texture pack. Frame hashes of all animations are stored
+// in one table, so the current frame is found without any search.
+class TextureAnimationTable
+{
+private:
+	std::vector<TextureAnimation> animations;	// sorted by NameHash
+	std::vector<std::uint32_t> frames;
+
+public:
+	bool addAnimation(const TextureAnim& textureAnim, const TextureAnimEntry* animEntries, std::size_t animEntriesCount);
+
+	bool empty() const { return animations.empty(); }
+	std::size_t getAnimationsCount() const { return animations.size(); }
+	const TextureAnimation* getAnimations() const { return animations.data(); }
+
+	// The pointer stays valid until the next animation is added
+	const TextureAnimation* find(std::uint32_t nameHash) const;
+
+	// Name hash of the texture which is shown at the time (in seconds) from the animation start
+	std::uint32_t getFrameHash(const TextureAnimation& animation, float time) const
+	{
+		std::int64_t ticks = animation.TimeBase;
+		if (animation.FramesPerSecond != 0 && time > 0.0f) {
+			ticks += static_cast<std::int64_t>(time * animation.FramesPerSecond);
+		}
+
+		// Time base can be negative, so the frame is wrapped in both directions
+		const std::int64_t framesCount = animation.FramesCount;
+		return frames[animation.FirstFrame + ((ticks % framesCount) + framesCount) % framesCount];
+	}
+};
+
+// Texture animations by texture pack hash
+extern nfr::api::binary_hash_map<TextureAnimationTable> TextureAnimationsMap;
+
+}
@@ -0,0 +1,197 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+
+namespace bb
+{
+
+static std::uint64_t
+GetArchiveIndexSize(std::uint32_t entriesCount)
+{
+	const std::uint64_t indexSize = sizeof(TextureArchiveHeader) + static_cast<std::uint64_t>(entriesCount) * sizeof(TextureArchiveEntry);
+	return ALIGN_VALUE(indexSize, static_cast<std::uint64_t>(TextureArchiveAlignment));
+}
+
+static nfr::api::IStream*
+CreateArchiveFile(const nfr::api::path& archivePath)
+{
+	if (EngineFactory->exists(archivePath)) {
+		std::filesystem::remove(archivePath);
+	}
+
+	return EngineFactory->openFile(nfr::api::EStreamFlags::WriteFlag, archivePath);
+}
+
+TextureArchiveWriter::TextureArchiveWriter(const nfr::api::path& archivePath, std::uint32_t inPackHash, std::uint32_t inMaxEntriesCount)
+	: stream(CreateArchiveFile(archivePath)), packHash(inPackHash), maxEntriesCount(inMaxEntriesCount)
+{
+	if (!stream->isOpen()) {
+		dbg::Warning("Couldn't create texture archive {}.", archivePath.generic_string());
+		return;
+	}
+
+	entries.reserve(maxEntriesCount);
+
+	// Index is written on close, when all entries are known
+	const std::vector<char> indexPlaceholder(GetArchiveIndexSize(maxEntriesCount));
+	writeData(indexPlaceholder.data(), indexPlaceholder.size());
+	writeOffset = indexPlaceholder.size();
+}
+
+bool
+TextureArchiveWriter::writeData(const void* data, std::uint64_t dataSize)
+{
+	if (stream->write(const_cast<void*>(data), static_cast<std::int64_t>(dataSize)) != static_cast<std::int64_t>(dataSize)) {
+		dbg::Warning("Couldn't write {} bytes to texture archive {:#06x}.", dataSize, packHash);
+		bWriteFailed = true;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+TextureArchiveWriter::isOpen() const
+{
+	return !bClosed && !bWriteFailed && stream->isOpen();
+}
+
+bool
+TextureArchiveWriter::addTexture(
+	std::uint32_t nameHash,
+	ENFSTextureFormat format,
+	std::int32_t width,
+	std::int32_t height,
+	std::int32_t mipLevels,
+	const char* data,
+	std::size_t dataSize
+)
+{
+	static const char paddingBuffer[TextureArchiveAlignment] = {};
+
+	std::lock_guard<std::mutex> lock(writeLock);
+	if (!isOpen()) {
+		return false;
+	}
+
+	if (entries.size() >= maxEntriesCount) {
+		dbg::Warning("Texture archive {:#06x} is full. Skipping texture {:#06x}...", packHash, nameHash);
+		return false;
+	}
+
+	TextureArchiveEntry& entry = entries.emplace_back();
+	entry.NameHash = nameHash;
+	entry.Format = format;
+	entry.Width = static_cast<std::uint16_t>(width);
+	entry.Height = static_cast<std::uint16_t>(height);
+	entry.MipLevels = static_cast<std::uint16_t>(mipLevels);
+	entry.Padding = 0;
+	entry.Offset = writeOffset;
+	entry.Size = dataSize;
+
+	const std::uint64_t alignedSize = ALIGN_VALUE(static_cast<std::uint64_t>(dataSize), static_cast<std::uint64_t>(TextureArchiveAlignment));
+	if (!writeData(data, dataSize) || !writeData(paddingBuffer, alignedSize - dataSize)) {
+		entries.pop_back();
+		return false;
+	}
+
+	writeOffset += alignedSize;
+	return true;
+}
+
+bool
+TextureArchiveWriter::close()
+{
+	std::lock_guard<std::mutex> lock(writeLock);
+	if (!isOpen()) {
+		return false;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const TextureArchiveEntry& left, const TextureArchiveEntry& right) {
+		return left.NameHash < right.NameHash;
+	});
+
+	TextureArchiveHeader header = {};
+	header.Magic = TextureArchiveMagic;
+	header.Version = TextureArchiveVersion;
+	header.PackHash = packHash;
+	header.EntriesCount = static_cast<std::uint32_t>(entries.size());
+
+	bClosed = true;
+	stream->seek(nfr::api::EStreamMode::Set, 0);
+	if (!writeData(&header, sizeof(TextureArchiveHeader)) || !writeData(entries.data(), entries.size() * sizeof(TextureArchiveEntry))) {
+		return false;
+	}
+
+	dbg::Verbose("    Written texture archive {:#06x} with {} textures ({} bytes)", packHash, entries.size(), writeOffset);
+	return true;
+}
+
+bool
+TextureArchiveView::open(const char* data, std::size_t dataSize)
+{
+	if (dataSize < sizeof(TextureArchiveHeader)) {
+		dbg::Warning("Texture archive is smaller than its header.");
+		return false;
+	}
+
+	const TextureArchiveHeader* header = reinterpret_cast<const TextureArchiveHeader*>(data);
+	if (header->Magic != TextureArchiveMagic || header->Version != TextureArchiveVersion) {
+		dbg::Warning("Invalid texture archive (magic {:#06x}, version {}).", header->Magic, header->Version);
+		return false;
+	}
+
+	if (GetArchiveIndexSize(header->EntriesCount) > dataSize) {
+		dbg::Warning("Texture archive index is out of file bounds.");
+		return false;
+	}
+
+	const TextureArchiveEntry* archiveEntries = reinterpret_cast<const TextureArchiveEntry*>(header + 1);
+	for (std::uint32_t i = 0; i < header->EntriesCount; i++) {
+		const TextureArchiveEntry& entry = archiveEntries[i];
+		if (entry.Offset > dataSize || entry.Size > dataSize - entry.Offset) {
+			dbg::Warning("Texture {:#06x} is out of texture archive bounds.", entry.NameHash);
+			return false;
+		}
+	}
+
+	archiveData = data;
+	archiveSize = dataSize;
+	entries = archiveEntries;
+	entriesCount = header->EntriesCount;
+	return true;
+}
+
+const TextureArchiveEntry*
+TextureArchiveView::find(std::uint32_t nameHash) const
+{
+	const TextureArchiveEntry* entriesEnd = entries + entriesCount;
+	const TextureArchiveEntry* entry = std::lower_bound(entries, entriesEnd, nameHash, [](const TextureArchiveEntry& left, std::uint32_t right) {
+		return left.NameHash < right;
+	});
+
+	if (entry == entriesEnd || entry->NameHash != nameHash) {
+		return nullptr;
+	}
+
+	return entry;
+}
+
+}
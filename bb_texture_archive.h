@@ -0,0 +1,113 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+#include <mutex>
+
+namespace bb
+{
+
+enum class ETextureOutputMode : std::uint32_t
+{
+	Files,		// textures/<name>.dds for every texture
+	Archive		// textures/<pack hash>.bbta for every texture pack
+};
+
+extern ETextureOutputMode TextureOutputMode;
+
+/*
+	Texture archive layout:
+
+	TextureArchiveHeader
+	TextureArchiveEntry[EntriesCount]	- sorted by NameHash
+	padding to TextureArchiveAlignment
+	payloads							- every payload is aligned by TextureArchiveAlignment
+
+	Payload is linear PC data of all mip levels (DDS layout without header), so it can be
+	uploaded directly from the mapped file.
+*/
+constexpr std::uint32_t TextureArchiveMagic = 0x41544242; // BBTA
+constexpr std::uint32_t TextureArchiveVersion = 1;
+constexpr std::uint32_t TextureArchiveAlignment = 4096;
+
+struct TextureArchiveHeader
+{
+	std::uint32_t Magic;
+	std::uint32_t Version;
+	std::uint32_t PackHash;
+	std::uint32_t EntriesCount;
+};
+
+struct TextureArchiveEntry
+{
+	std::uint32_t NameHash;
+	ENFSTextureFormat Format;
+	std::uint16_t Width;
+	std::uint16_t Height;
+	std::uint16_t MipLevels;
+	std::uint16_t Padding;
+	std::uint64_t Offset;
+	std::uint64_t Size;
+};
+
+// Writes textures of one pack into the archive. Textures can be added from different threads.
+class TextureArchiveWriter
+{
+private:
+	nfr::api::SafeInterface<nfr::api::IStream> stream;
+	std::mutex writeLock;
+	std::vector<TextureArchiveEntry> entries;
+	std::uint32_t packHash = 0;
+	std::uint32_t maxEntriesCount = 0;
+	std::uint64_t writeOffset = 0;
+
+	bool bClosed = false;
+	bool bWriteFailed = false;	// the archive is incomplete after a short write, so the whole pack fails
+
+	bool writeData(const void* data, std::uint64_t dataSize);
+
+public:
+	// maxEntriesCount - count of textures in pack, space for the index is reserved at the beginning of file
+	TextureArchiveWriter(const nfr::api::path& archivePath, std::uint32_t inPackHash, std::uint32_t inMaxEntriesCount);
+
+	bool isOpen() const;
+	bool addTexture(std::uint32_t nameHash, ENFSTextureFormat format, std::int32_t width, std::int32_t height, std::int32_t mipLevels, const char* data, std::size_t dataSize);
+	bool close();
+};
+
+// Read-only view over archive data (e.g. mapped file). Doesn't copy anything.
+class TextureArchiveView
+{
+private:
+	const char* archiveData = nullptr;
+	std::size_t archiveSize = 0;
+	const TextureArchiveEntry* entries = nullptr;
+	std::uint32_t entriesCount = 0;
+
+public:
+	bool open(const char* data, std::size_t dataSize);
+
+	std::uint32_t getEntriesCount() const { return entriesCount; }
+	const TextureArchiveEntry* getEntries() const { return entries; }
+
+	const TextureArchiveEntry* find(std::uint32_t nameHash) const;
+	const char* getPayload(const TextureArchiveEntry& entry) const { return archiveData + entry.Offset; }
+};
+
+}
@@ -0,0 +1,309 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+
+namespace bb
+{
+
+struct SkylineNode
+{
+	std::int32_t X;
+	std::int32_t Y;
+	std::int32_t Width;
+};
+
+static inline std::int32_t
+AlignToBlock(std::int32_t value)
+{
+	return (value + 3) & ~3;
+}
+
+// Returns the lowest y where the cell fits at node index (or -1)
+static std::int32_t
+FitSkylineNode(const std::vector<SkylineNode>& skyline, std::size_t nodeIndex, std::int32_t cellWidth, std::int32_t cellHeight)
+{
+	const std::int32_t x = skyline[nodeIndex].X;
+	if (x + cellWidth > TextureAtlasSize) {
+		return -1;
+	}
+
+	std::int32_t y = 0;
+	std::int32_t widthLeft = cellWidth;
+	for (std::size_t i = nodeIndex; widthLeft > 0; i++) {
+		y = std::max(y, skyline[i].Y);
+		if (y + cellHeight > TextureAtlasSize) {
+			return -1;
+		}
+
+		widthLeft -= skyline[i].Width;
+	}
+
+	return y;
+}
+
+static void
+AddSkylineLevel(std::vector<SkylineNode>& skyline, std::size_t nodeIndex, std::int32_t x, std::int32_t y, std::int32_t cellWidth)
+{
+	skyline.insert(skyline.begin() + nodeIndex, { x, y, cellWidth });
+
+	// Nodes under the new one are shrinked or removed
+	for (std::size_t i = nodeIndex + 1; i < skyline.size(); ) {
+		const std::int32_t shrink = (x + cellWidth) - skyline[i].X;
+		if (shrink <= 0) {
+			break;
+		}
+
+		if (skyline[i].Width > shrink) {
+			skyline[i].X += shrink;
+			skyline[i].Width -= shrink;
+			break;
+		}
+
+		skyline.erase(skyline.begin() + i);
+	}
+
+	for (std::size_t i = 0; i + 1 < skyline.size(); ) {
+		if (skyline[i].Y == skyline[i + 1].Y) {
+			skyline[i].Width += skyline[i + 1].Width;
+			skyline.erase(skyline.begin() + i + 1);
+		} else {
+			i++;
+		}
+	}
+}
+
+static bool
+InsertSkylineCell(std::vector<SkylineNode>& skyline, std::int32_t cellWidth, std::int32_t cellHeight, std::int32_t& outX, std::int32_t& outY)
+{
+	std::size_t bestIndex = skyline.size();
+	std::int32_t bestY = TextureAtlasSize;
+	for (std::size_t i = 0; i < skyline.size(); i++) {
+		const std::int32_t y = FitSkylineNode(skyline, i, cellWidth, cellHeight);
+		if (y >= 0 && y < bestY) {
+			bestY = y;
+			bestIndex = i;
+		}
+	}
+
+	if (bestIndex == skyline.size()) {
+		return false;
+	}
+
+	outX = skyline[bestIndex].X;
+	outY = bestY;
+	AddSkylineLevel(skyline, bestIndex, outX, bestY + cellHeight, cellWidth);
+	return true;
+}
+
+bool
+TextureAtlasBuilder::IsUITexturePack(const TexturePackHeader& packHeader)
+{
+	std::string packName(packHeader.Filename, strnlen(packHeader.Filename, sizeof(packHeader.Filename)));
+	std::transform(packName.begin(), packName.end(), packName.begin(), [](char symbol) {
+		return static_cast<char>(std::toupper(static_cast<unsigned char>(symbol)));
+	});
+
+	return packName.find("FRONTEND") != std::string::npos;
+}
+
+bool
+TextureAtlasBuilder::CanBePacked(std::int32_t width, std::int32_t height)
+{
+	return width > 0 && height > 0 && width <= TextureAtlasMaxTextureSize && height <= TextureAtlasMaxTextureSize;
+}
+
+void
+TextureAtlasBuilder::addTexture(std::uint32_t nameHash, std::int32_t width, std::int32_t height, const char* rgbaData)
+{
+	AtlasTexture texture = { nameHash, width, height, std::vector<char>(rgbaData, rgbaData + width * height * 4) };
+
+	std::lock_guard<std::mutex> lock(addLock);
+	textures.emplace_back(std::move(texture));
+}
+
+bool
+TextureAtlasBuilder::writeAtlas(std::uint32_t packHash, std::uint32_t atlasIndex, std::int32_t atlasHeight, const std::vector<char>& atlasPixels) const
+{
+	std::vector<char> encodedData;
+	if (!TextureConverter::EncodeTexture(TextureAtlasSize, atlasHeight, 1, ENFSTextureFormat::RGBA8, ENFSTextureFormat::BC3, atlasPixels.data(), atlasPixels.size(), encodedData)) {
+		return false;
+	}
+
+	nfr::api::path atlasPath = EngineFactory->getResourcesDirectory();
+	atlasPath.append("ui");
+	atlasPath.append(std::to_string(packHash) + "_atlas_" + std::to_string(atlasIndex) + ".dds");
+
+	nfr::api::SafeInterface<nfr::api::IStream> atlasStream = TextureConverter::CreateOutputFile(atlasPath);
+	if (!atlasStream->isOpen()) {
+		dbg::Warning("Couldn't create atlas file \"{}\".", atlasPath.generic_string());
+		return false;
+	}
+
+	// Mip levels would mix neighbour textures, UI is drawn without them anyway
+	return TextureConverter::WriteDDSHeader(atlasStream.get(), ENFSTextureFormat::BC3, TextureAtlasSize, atlasHeight, 1) &&
+		TextureConverter::WriteDDSData(atlasStream.get(), encodedData.data(), encodedData.size());
+}
+
+bool
+TextureAtlasBuilder::writeRemapTable(std::uint32_t packHash, const std::vector<TextureAtlasEntry>& entries) const
+{
+	nfr::api::path tablePath = EngineFactory->getResourcesDirectory();
+	tablePath.append("ui");
+	tablePath.append(std::to_string(packHash) + "_atlas.json");
+
+	std::string jsonTable = "[\n";
+	for (std::size_t i = 0; i < entries.size(); i++) {
+		const TextureAtlasEntry& entry = entries[i];
+		jsonTable += fmt::format("\t{{ \"name\": {}, \"atlas\": {}, \"x\": {}, \"y\": {}, \"width\": {}, \"height\": {}, \"uv\": [ {}, {}, {}, {} ] }}",
+			entry.NameHash,
+			entry.AtlasIndex,
+			entry.X,
+			entry.Y,
+			entry.Width,
+			entry.Height,
+			entry.UV[0],
+			entry.UV[1],
+			entry.UV[2],
+			entry.UV[3]
+		);
+
+		jsonTable += (i + 1 < entries.size()) ? ",\n" : "\n";
+	}
+
+	jsonTable += "]\n";
+
+	nfr::api::SafeInterface<nfr::api::IStream> tableStream = TextureConverter::CreateOutputFile(tablePath);
+	if (!tableStream->isOpen()) {
+		dbg::Warning("Couldn't create atlas remap table \"{}\".", tablePath.generic_string());
+		return false;
+	}
+
+	return tableStream->write(jsonTable.data(), jsonTable.size()) == static_cast<std::int64_t>(jsonTable.size());
+}
+
+bool
+TextureAtlasBuilder::write(std::uint32_t packHash)
+{
+	if (textures.empty()) {
+		return true;
+	}
+
+	// Textures come from different threads, sorting makes atlases the same on every run
+	std::sort(textures.begin(), textures.end(), [](const AtlasTexture& left, const AtlasTexture& right) {
+		if (left.Height != right.Height) {
+			return left.Height > right.Height;
+		}
+
+		if (left.Width != right.Width) {
+			return left.Width > right.Width;
+		}
+
+		return left.NameHash < right.NameHash;
+	});
+
+	std::vector<TextureAtlasEntry> entries;
+	std::vector<std::int32_t> atlasesHeight;
+	std::vector<SkylineNode> skyline;
+	entries.reserve(textures.size());
+
+	for (const AtlasTexture& texture : textures) {
+		const std::int32_t cellWidth = AlignToBlock(texture.Width) + TextureAtlasPadding * 2;
+		const std::int32_t cellHeight = AlignToBlock(texture.Height) + TextureAtlasPadding * 2;
+
+		std::int32_t x = 0;
+		std::int32_t y = 0;
+		if (atlasesHeight.empty() || !InsertSkylineCell(skyline, cellWidth, cellHeight, x, y)) {
+			skyline.assign(1, { 0, 0, TextureAtlasSize });
+			atlasesHeight.push_back(0);
+			InsertSkylineCell(skyline, cellWidth, cellHeight, x, y);
+		}
+
+		TextureAtlasEntry entry = {};
+		entry.NameHash = texture.NameHash;
+		entry.AtlasIndex = static_cast<std::uint32_t>(atlasesHeight.size() - 1);
+		entry.X = x + TextureAtlasPadding;
+		entry.Y = y + TextureAtlasPadding;
+		entry.Width = texture.Width;
+		entry.Height = texture.Height;
+		entries.push_back(entry);
+
+		atlasesHeight.back() = std::max(atlasesHeight.back(), y + cellHeight);
+	}
+
+	// Unused bottom part of the atlas is cropped to the power of two
+	for (std::int32_t& atlasHeight : atlasesHeight) {
+		std::int32_t croppedHeight = 4;
+		while (croppedHeight < atlasHeight) {
+			croppedHeight *= 2;
+		}
+
+		atlasHeight = croppedHeight;
+	}
+
+	for (TextureAtlasEntry& entry : entries) {
+		const float atlasHeight = static_cast<float>(atlasesHeight[entry.AtlasIndex]);
+		entry.UV[0] = static_cast<float>(entry.X) / TextureAtlasSize;
+		entry.UV[1] = static_cast<float>(entry.Y) / atlasHeight;
+		entry.UV[2] = static_cast<float>(entry.X + entry.Width) / TextureAtlasSize;
+		entry.UV[3] = static_cast<float>(entry.Y + entry.Height) / atlasHeight;
+	}
+
+	bool bWriteFailed = false;
+	std::vector<char> atlasPixels;
+	for (std::uint32_t atlasIndex = 0; atlasIndex < atlasesHeight.size(); atlasIndex++) {
+		const std::int32_t atlasHeight = atlasesHeight[atlasIndex];
+		atlasPixels.assign(static_cast<std::size_t>(TextureAtlasSize) * atlasHeight * 4, 0);
+
+		// Padding around every texture is filled by its clamped edges, so filtering never reads neighbours
+		for (std::size_t i = 0; i < entries.size(); i++) {
+			const TextureAtlasEntry& entry = entries[i];
+			if (entry.AtlasIndex != atlasIndex) {
+				continue;
+			}
+
+			const AtlasTexture& texture = textures[i];
+			const std::int32_t cellX = entry.X - TextureAtlasPadding;
+			const std::int32_t cellY = entry.Y - TextureAtlasPadding;
+			const std::int32_t cellWidth = AlignToBlock(texture.Width) + TextureAtlasPadding * 2;
+			const std::int32_t cellHeight = AlignToBlock(texture.Height) + TextureAtlasPadding * 2;
+			for (std::int32_t y = 0; y < cellHeight; y++) {
+				const std::int32_t sourceY = std::clamp(y - TextureAtlasPadding, 0, texture.Height - 1);
+				char* atlasRow = atlasPixels.data() + (static_cast<std::size_t>(cellY + y) * TextureAtlasSize + cellX) * 4;
+				for (std::int32_t x = 0; x < cellWidth; x++) {
+					const std::int32_t sourceX = std::clamp(x - TextureAtlasPadding, 0, texture.Width - 1);
+					std::memcpy(atlasRow + x * 4, texture.Pixels.data() + (static_cast<std::size_t>(sourceY) * texture.Width + sourceX) * 4, 4);
+				}
+			}
+		}
+
+		if (!writeAtlas(packHash, atlasIndex, atlasHeight, atlasPixels)) {
+			bWriteFailed = true;
+		}
+	}
+
+	if (!writeRemapTable(packHash, entries)) {
+		bWriteFailed = true;
+	}
+
+	dbg::Verbose("    Packed {} textures into {} atlases.", entries.size(), atlasesHeight.size());
+	return !bWriteFailed;
+}
+
+}
@@ -0,0 +1,78 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+#include <mutex>
+
+namespace bb
+{
+
+// Small textures of frontend packs are packed into atlases instead of separate DDS files
+extern bool PackUITextureAtlases;
+
+constexpr std::int32_t TextureAtlasSize = 1024;
+constexpr std::int32_t TextureAtlasMaxTextureSize = 128;
+constexpr std::int32_t TextureAtlasPadding = 4;		// filled by edge pixels, keeps every texture on BC block boundaries
+
+struct TextureAtlasEntry
+{
+	std::uint32_t NameHash;
+	std::uint32_t AtlasIndex;
+	std::int32_t X;
+	std::int32_t Y;
+	std::int32_t Width;
+	std::int32_t Height;
+	float UV[4];		// left, top, right, bottom
+};
+
+/*
+	Collects small RGBA8 textures of one pack (can be added from different threads), packs them
+	with skyline bottom-left algorithm and writes BC3 atlases:
+
+	ui/<pack hash>_atlas_<index>.dds
+	ui/<pack hash>_atlas.json			- UV remap table by texture name hash
+*/
+class TextureAtlasBuilder
+{
+private:
+	struct AtlasTexture
+	{
+		std::uint32_t NameHash;
+		std::int32_t Width;
+		std::int32_t Height;
+		std::vector<char> Pixels;
+	};
+
+	std::mutex addLock;
+	std::vector<AtlasTexture> textures;
+
+	bool writeAtlas(std::uint32_t packHash, std::uint32_t atlasIndex, std::int32_t atlasHeight, const std::vector<char>& atlasPixels) const;
+	bool writeRemapTable(std::uint32_t packHash, const std::vector<TextureAtlasEntry>& entries) const;
+
+public:
+	static bool IsUITexturePack(const TexturePackHeader& packHeader);
+	static bool CanBePacked(std::int32_t width, std::int32_t height);
+
+	void addTexture(std::uint32_t nameHash, std::int32_t width, std::int32_t height, const char* rgbaData);
+	std::size_t getTexturesCount() const { return textures.size(); }
+
+	bool write(std::uint32_t packHash);
+};
+
+}
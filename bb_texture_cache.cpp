@@ -0,0 +1,142 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <mutex>
+
+namespace bb
+{
+
+static constexpr std::uint32_t TextureCacheMagic = 0x43544242; // BBTC
+static constexpr std::uint32_t TextureCacheVersion = 2;
+
+static std::mutex CacheLock;
+static std::unordered_map<std::uint64_t, std::uint64_t> SourceHashes;
+static std::atomic<std::size_t> SkippedCount = 0;
+
+static inline std::uint64_t
+GetCacheKey(std::uint32_t outputHash, std::uint32_t fileHash)
+{
+	return (static_cast<std::uint64_t>(outputHash) << 32) | fileHash;
+}
+
+std::uint64_t
+TextureConversionCache::GetSettingsHash()
+{
+	const std::uint32_t settings[] = {
+		TextureConverterVersion,
+		static_cast<std::uint32_t>(TextureOutputMode),
+		GenerateMissingMipLevels ? 1u : 0u,
+		PackUITextureAtlases ? 1u : 0u
+	};
+
+	return HashData(settings, sizeof(settings));
+}
+
+bool
+TextureConversionCache::Load(nfr::api::IStream* inFile)
+{
+	TextureCacheHeader header = {};
+	if (inFile->read(&header, sizeof(header)) != sizeof(header) || header.Magic != TextureCacheMagic) {
+		return false;
+	}
+
+	if (header.Version != TextureCacheVersion || header.SettingsHash != GetSettingsHash()) {
+		dbg::Log("Texture conversion settings were changed, all textures will be converted again.");
+		return false;
+	}
+
+	std::vector<TextureCacheEntry> entries(header.EntriesCount);
+	const std::int64_t entriesSize = static_cast<std::int64_t>(entries.size() * sizeof(TextureCacheEntry));
+	if (inFile->read(entries.data(), entriesSize) != entriesSize) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(CacheLock);
+	SourceHashes.reserve(entries.size());
+	for (const TextureCacheEntry& entry : entries) {
+		SourceHashes[GetCacheKey(entry.OutputHash, entry.FileHash)] = entry.SourceHash;
+	}
+
+	return true;
+}
+
+bool
+TextureConversionCache::Save(nfr::api::IStream* outFile)
+{
+	std::vector<TextureCacheEntry> entries;
+	{
+		std::lock_guard<std::mutex> lock(CacheLock);
+		entries.reserve(SourceHashes.size());
+		for (const auto& it : SourceHashes) {
+			entries.push_back({ static_cast<std::uint32_t>(it.first >> 32), static_cast<std::uint32_t>(it.first), it.second });
+		}
+	}
+
+	// Sorted to get the same file for the same textures
+	std::sort(entries.begin(), entries.end(), [](const TextureCacheEntry& left, const TextureCacheEntry& right) {
+		return GetCacheKey(left.OutputHash, left.FileHash) < GetCacheKey(right.OutputHash, right.FileHash);
+	});
+
+	TextureCacheHeader header = {};
+	header.Magic = TextureCacheMagic;
+	header.Version = TextureCacheVersion;
+	header.SettingsHash = GetSettingsHash();
+	header.EntriesCount = static_cast<std::uint32_t>(entries.size());
+
+	const std::int64_t entriesSize = static_cast<std::int64_t>(entries.size() * sizeof(TextureCacheEntry));
+	return outFile->write(&header, sizeof(header)) == sizeof(header) && outFile->write(entries.data(), entriesSize) == entriesSize;
+}
+
+void
+TextureConversionCache::Reset()
+{
+	std::lock_guard<std::mutex> lock(CacheLock);
+	SourceHashes.clear();
+	SkippedCount = 0;
+}
+
+bool
+TextureConversionCache::IsUpToDate(std::uint32_t outputHash, std::uint32_t fileHash, std::uint64_t sourceHash)
+{
+	std::lock_guard<std::mutex> lock(CacheLock);
+	auto it = SourceHashes.find(GetCacheKey(outputHash, fileHash));
+	return it != SourceHashes.end() && it->second == sourceHash;
+}
+
+void
+TextureConversionCache::Update(std::uint32_t outputHash, std::uint32_t fileHash, std::uint64_t sourceHash)
+{
+	std::lock_guard<std::mutex> lock(CacheLock);
+	SourceHashes[GetCacheKey(outputHash, fileHash)] = sourceHash;
+}
+
+void
+TextureConversionCache::CountSkipped(std::size_t texturesCount)
+{
+	SkippedCount += texturesCount;
+}
+
+std::size_t
+TextureConversionCache::GetSkippedCount()
+{
+	return SkippedCount;
+}
+
+}
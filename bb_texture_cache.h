@@ -0,0 +1,67 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+// Bumped when the converter output changes, so all cached textures are converted again
+constexpr std::uint32_t TextureConverterVersion = 1;
+
+struct TextureCacheHeader
+{
+	std::uint32_t Magic;			// BBTC
+	std::uint32_t Version;
+	std::uint64_t SettingsHash;		// textures converted with other settings are never up to date
+	std::uint32_t EntriesCount;
+	std::uint32_t Padding;
+};
+
+struct TextureCacheEntry
+{
+	std::uint32_t OutputHash;		// pack hash for archives, LooseFilesOutputHash for textures/<name>.dds files
+	std::uint32_t FileHash;			// texture name hash in archives, upper hash of the file name for loose files
+	std::uint64_t SourceHash;
+};
+
+// Loose files are shared by all packs, so they are keyed by the file name only
+constexpr std::uint32_t LooseFilesOutputHash = 0;
+
+// Remembers the source content of every converted texture between runs (textures/conversion_cache.bin).
+// Textures with the same source and conversion settings are not converted again.
+class TextureConversionCache
+{
+public:
+	static std::uint64_t GetSettingsHash();
+
+	// Entries made with other settings or by other cache version are dropped
+	static bool Load(nfr::api::IStream* inFile);
+	static bool Save(nfr::api::IStream* outFile);
+	static void Reset();
+
+	// The key is the output file, so the texture written by another pack to the same file is converted again
+	static bool IsUpToDate(std::uint32_t outputHash, std::uint32_t fileHash, std::uint64_t sourceHash);
+	static void Update(std::uint32_t outputHash, std::uint32_t fileHash, std::uint64_t sourceHash);
+
+	static void CountSkipped(std::size_t texturesCount);
+	static std::size_t GetSkippedCount();
+};
+
+}
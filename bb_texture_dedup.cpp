@@ -0,0 +1,247 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <mutex>
+
+namespace bb
+{
+
+struct TextureContent
+{
+	std::uint32_t NameHash;
+	std::uint64_t Size;
+};
+
+struct TextureAlias
+{
+	std::uint32_t NameHash;
+	std::uint32_t OriginalHash;
+};
+
+static std::mutex ContentLock;
+static std::unordered_map<std::uint64_t, TextureContent> ContentMap;
+static std::vector<TextureAlias> Aliases;
+static std::uint64_t DuplicatesCount = 0;
+static std::uint64_t SavedBytes = 0;
+
+static constexpr std::uint64_t HashPrime1 = 0x9E3779B185EBCA87ULL;
+static constexpr std::uint64_t HashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr std::uint64_t HashPrime3 = 0x165667B19E3779F9ULL;
+static constexpr std::uint64_t HashPrime4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr std::uint64_t HashPrime5 = 0x27D4EB2F165667C5ULL;
+
+static inline std::uint64_t
+RotateLeft(std::uint64_t value, std::int32_t bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline std::uint64_t
+ReadWord(const std::uint8_t* data)
+{
+	std::uint64_t word = 0;
+	std::memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+static inline std::uint64_t
+HashRound(std::uint64_t accumulator, std::uint64_t word)
+{
+	accumulator += word * HashPrime2;
+	accumulator = RotateLeft(accumulator, 31);
+	return accumulator * HashPrime1;
+}
+
+static inline std::uint64_t
+HashMergeRound(std::uint64_t accumulator, std::uint64_t lane)
+{
+	accumulator ^= HashRound(0, lane);
+	return accumulator * HashPrime1 + HashPrime4;
+}
+
+std::uint64_t
+HashData(const void* data, std::size_t dataSize, std::uint64_t seed)
+{
+	const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+	const std::uint8_t* bytesEnd = bytes + dataSize;
+	std::uint64_t hash = 0;
+
+	if (dataSize >= 32) {
+		std::uint64_t lanes[4] = { seed + HashPrime1 + HashPrime2, seed + HashPrime2, seed, seed - HashPrime1 };
+		for (; bytes + 32 <= bytesEnd; bytes += 32) {
+			lanes[0] = HashRound(lanes[0], ReadWord(bytes));
+			lanes[1] = HashRound(lanes[1], ReadWord(bytes + 8));
+			lanes[2] = HashRound(lanes[2], ReadWord(bytes + 16));
+			lanes[3] = HashRound(lanes[3], ReadWord(bytes + 24));
+		}
+
+		hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+		for (std::uint64_t lane : lanes) {
+			hash = HashMergeRound(hash, lane);
+		}
+	} else {
+		hash = seed + HashPrime5;
+	}
+
+	hash += dataSize;
+	for (; bytes + 8 <= bytesEnd; bytes += 8) {
+		hash ^= HashRound(0, ReadWord(bytes));
+		hash = RotateLeft(hash, 27) * HashPrime1 + HashPrime4;
+	}
+
+	if (bytes + 4 <= bytesEnd) {
+		std::uint32_t word = 0;
+		std::memcpy(&word, bytes, sizeof(word));
+		hash ^= word * HashPrime1;
+		hash = RotateLeft(hash, 23) * HashPrime2 + HashPrime3;
+		bytes += 4;
+	}
+
+	for (; bytes < bytesEnd; bytes++) {
+		hash ^= (*bytes) * HashPrime5;
+		hash = RotateLeft(hash, 11) * HashPrime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= HashPrime2;
+	hash ^= hash >> 29;
+	hash *= HashPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+std::uint64_t
+TextureDeduplicator::HashTexture(
+	ENFSTextureFormat format,
+	std::int32_t width,
+	std::int32_t height,
+	std::int32_t mipLevels,
+	const char* data,
+	std::size_t dataSize
+)
+{
+	// Same bytes with different description are different textures
+	const std::uint64_t seed = (static_cast<std::uint64_t>(format) << 48) ^
+		(static_cast<std::uint64_t>(width & 0xFFFF) << 32) ^
+		(static_cast<std::uint64_t>(height & 0xFFFF) << 16) ^
+		static_cast<std::uint64_t>(mipLevels & 0xFFFF);
+
+	return HashData(data, dataSize, seed);
+}
+
+bool
+TextureDeduplicator::Register(std::uint32_t nameHash, std::uint64_t contentHash, std::uint64_t contentSize, std::uint32_t& outOriginalHash)
+{
+	std::lock_guard<std::mutex> lock(ContentLock);
+	auto it = ContentMap.find(contentHash);
+	if (it == ContentMap.end() || it->second.Size != contentSize) {
+		ContentMap[contentHash] = { nameHash, contentSize };
+		outOriginalHash = nameHash;
+		return true;
+	}
+
+	outOriginalHash = it->second.NameHash;
+	DuplicatesCount++;
+	SavedBytes += contentSize;
+
+	// The same texture can be stored in many packs, alias is needed only for different names
+	if (outOriginalHash != nameHash) {
+		Aliases.push_back({ nameHash, outOriginalHash });
+	}
+
+	return false;
+}
+
+void
+TextureDeduplicator::Unregister(std::uint32_t nameHash, std::uint64_t contentHash)
+{
+	std::lock_guard<std::mutex> lock(ContentLock);
+	auto it = ContentMap.find(contentHash);
+	if (it == ContentMap.end() || it->second.NameHash != nameHash) {
+		return;
+	}
+
+	const std::uint64_t contentSize = it->second.Size;
+	ContentMap.erase(it);
+
+	auto aliasesEnd = std::remove_if(Aliases.begin(), Aliases.end(), [nameHash](const TextureAlias& alias) {
+		return alias.OriginalHash == nameHash;
+	});
+
+	const std::uint64_t removedCount = static_cast<std::uint64_t>(Aliases.end() - aliasesEnd);
+	Aliases.erase(aliasesEnd, Aliases.end());
+	DuplicatesCount -= std::min(DuplicatesCount, removedCount);
+	SavedBytes -= std::min(SavedBytes, removedCount * contentSize);
+}
+
+void
+TextureDeduplicator::Reset()
+{
+	std::lock_guard<std::mutex> lock(ContentLock);
+	ContentMap.clear();
+	Aliases.clear();
+	DuplicatesCount = 0;
+	SavedBytes = 0;
+}
+
+std::size_t
+TextureDeduplicator::GetAliasesCount()
+{
+	std::lock_guard<std::mutex> lock(ContentLock);
+	return Aliases.size();
+}
+
+void
+TextureDeduplicator::LogReport()
+{
+	std::lock_guard<std::mutex> lock(ContentLock);
+	if (DuplicatesCount == 0) {
+		return;
+	}
+
+	dbg::Log("Skipped {} duplicated textures ({} KB, {} aliases) of {} unique ones.", DuplicatesCount, SavedBytes / 1024, Aliases.size(), ContentMap.size());
+}
+
+bool
+TextureDeduplicator::WriteAliases(nfr::api::IStream* outFile)
+{
+	std::vector<TextureAlias> sortedAliases;
+	{
+		std::lock_guard<std::mutex> lock(ContentLock);
+		sortedAliases = Aliases;
+	}
+
+	std::sort(sortedAliases.begin(), sortedAliases.end(), [](const TextureAlias& left, const TextureAlias& right) {
+		return left.NameHash < right.NameHash;
+	});
+
+	std::string jsonAliases = "[\n";
+	for (std::size_t i = 0; i < sortedAliases.size(); i++) {
+		const TextureAlias& alias = sortedAliases[i];
+		jsonAliases += "\t{ \"alias\": " + std::to_string(alias.NameHash);
+		jsonAliases += ", \"original\": " + std::to_string(alias.OriginalHash);
+		jsonAliases += (i + 1 < sortedAliases.size()) ? " },\n" : " }\n";
+	}
+
+	jsonAliases += "]\n";
+	return outFile->write(jsonAliases.data(), jsonAliases.size()) == static_cast<std::int64_t>(jsonAliases.size());
+}
+
+}
@@ -0,0 +1,49 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+// 64-bit hash of memory block (xxHash64 algorithm)
+std::uint64_t HashData(const void* data, std::size_t dataSize, std::uint64_t seed = 0);
+
+// Finds textures with the same content across all texture packs. Only the first texture
+// is converted and stored, the others are written to the aliases table (textures/aliases.json).
+class TextureDeduplicator
+{
+public:
+	static std::uint64_t HashTexture(ENFSTextureFormat format, std::int32_t width, std::int32_t height, std::int32_t mipLevels, const char* data, std::size_t dataSize);
+
+	// Returns false if the texture with the same content was already registered.
+	// outOriginalHash - name hash of the first texture with this content
+	static bool Register(std::uint32_t nameHash, std::uint64_t contentHash, std::uint64_t contentSize, std::uint32_t& outOriginalHash);
+
+	// Removes the original which couldn't be converted with all its aliases. Duplicates have the same
+	// content, so they would fail the same way and aren't converted again.
+	static void Unregister(std::uint32_t nameHash, std::uint64_t contentHash);
+	static void Reset();
+
+	static std::size_t GetAliasesCount();
+	static void LogReport();
+	static bool WriteAliases(nfr::api::IStream* outFile);
+};
+
+}
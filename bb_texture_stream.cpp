@@ -0,0 +1,366 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <list>
+#include <mutex>
+
+namespace bb
+{
+
+struct StreamedTextureSource
+{
+	std::uint32_t PackIndex;
+	StreamingEntry Entry;
+	TextureInfo Info;
+	ENFSTextureFormat Format;
+};
+
+// The pack file is opened once and shared by all requests, reads are serialized by the pack lock
+struct StreamedPack
+{
+	StreamedPack(nfr::api::SafeInterface<nfr::api::IStream> inStream, const nfr::api::path& inFilePath, std::uint32_t inNameHash, bool inIsXenonPlatform)
+		: FilePath(inFilePath), NameHash(inNameHash), IsXenonPlatform(inIsXenonPlatform), Stream(std::move(inStream)) {}
+
+	nfr::api::path FilePath;
+	std::uint32_t NameHash;
+	bool IsXenonPlatform;
+
+	std::mutex ReadLock;
+	nfr::api::SafeInterface<nfr::api::IStream> Stream;
+};
+
+using ResidentList = std::list<std::shared_ptr<const StreamedTexture>>;
+
+static std::mutex StreamLock;
+static std::vector<std::shared_ptr<StreamedPack>> Packs;
+static std::unordered_map<std::uint32_t, StreamedTextureSource> Sources;
+
+// Most recently used textures are at the front
+static ResidentList ResidentTextures;
+static std::unordered_map<std::uint32_t, ResidentList::iterator> ResidentMap;
+static std::size_t ResidentSize = 0;
+static std::size_t BudgetSize = DefaultTextureStreamingBudget;
+
+static std::uint64_t HitsCount = 0;
+static std::uint64_t MissesCount = 0;
+static std::uint64_t EvictionsCount = 0;
+
+static void
+EvictTextures()
+{
+	// The last requested texture is kept even if it doesn't fit the budget alone
+	while (ResidentSize > BudgetSize && ResidentTextures.size() > 1) {
+		const std::shared_ptr<const StreamedTexture>& texture = ResidentTextures.back();
+		ResidentSize -= texture->Data.size();
+		ResidentMap.erase(texture->NameHash);
+		ResidentTextures.pop_back();
+		EvictionsCount++;
+	}
+}
+
+static bool
+ReadStreamedData(StreamedPack& pack, const StreamingEntry& entry, std::vector<char>& outData)
+{
+	std::vector<char> chunkData;
+	{
+		std::lock_guard<std::mutex> lock(pack.ReadLock);
+		if (entry.ChunkByteSize <= 0 || static_cast<std::int64_t>(entry.ChunkByteOffset) + entry.ChunkByteSize > pack.Stream->getSize()) {
+			dbg::Warning("Streaming entry of texture {:#06x} is out of the pack file. Skipping texture...", entry.NameHash);
+			return false;
+		}
+
+		chunkData.resize(entry.ChunkByteSize);
+		pack.Stream->seek(nfr::api::EStreamMode::Set, entry.ChunkByteOffset);
+		if (pack.Stream->read(chunkData.data(), chunkData.size()) != static_cast<std::int64_t>(chunkData.size())) {
+			return false;
+		}
+	}
+
+	const JLZPackHeader* packHeader = reinterpret_cast<const JLZPackHeader*>(chunkData.data());
+	const bool isCompressed = chunkData.size() > sizeof(JLZPackHeader) && std::memcmp(packHeader->MagicWord, "JDLZ", 4) == 0;
+	if (!isCompressed) {
+		outData = std::move(chunkData);
+		return true;
+	}
+
+	if (packHeader->CompressedSize > chunkData.size() || packHeader->UncompressedSize < static_cast<std::uint32_t>(entry.UncompressedSize)) {
+		dbg::Warning("Invalid compressed data of texture {:#06x}. Skipping texture...", entry.NameHash);
+		return false;
+	}
+
+	outData.resize(packHeader->UncompressedSize);
+	JLZDecompress(
+		reinterpret_cast<std::uint8_t*>(chunkData.data()),
+		reinterpret_cast<std::uint8_t*>(outData.data()),
+		packHeader->CompressedSize,
+		packHeader->UncompressedSize
+	);
+
+	return true;
+}
+
+static std::shared_ptr<StreamedTexture>
+LoadStreamedTexture(StreamedPack& pack, const StreamedTextureSource& source)
+{
+	std::vector<char> streamedData;
+	if (!ReadStreamedData(pack, source.Entry, streamedData)) {
+		return nullptr;
+	}
+
+	// Streamed data is aligned in the same way as textures data chunk
+	std::size_t dataOffset = 0;
+	while (dataOffset + 4 <= streamedData.size() && std::memcmp(streamedData.data() + dataOffset, "\x11\x11\x11\x11", 4) == 0) {
+		dataOffset += 4;
+	}
+
+	const TextureInfo& textureInfo = source.Info;
+	if (streamedData.size() - dataOffset < static_cast<std::size_t>(textureInfo.ImageSize)) {
+		dbg::Warning("Streamed data of texture {:#06x} is smaller than the image ({} < {}).", textureInfo.NameHash, streamedData.size() - dataOffset, textureInfo.ImageSize);
+		return nullptr;
+	}
+
+	std::shared_ptr<StreamedTexture> texture = std::make_shared<StreamedTexture>();
+	texture->NameHash = textureInfo.NameHash;
+	texture->Format = source.Format;
+	texture->Width = textureInfo.Width;
+	texture->Height = textureInfo.Height;
+	texture->MipLevels = TextureConverter::GetMipLevelsCount(source.Format, textureInfo.Width, textureInfo.Height, textureInfo.NumMipMapLevels, textureInfo.ImageSize);
+
+	const char* textureData = streamedData.data() + dataOffset;
+	if (pack.IsXenonPlatform) {
+		if (!TextureConverter::UntileXenonTexture(textureInfo.Width, textureInfo.Height, textureInfo.NumMipMapLevels, GetTextureBlockSize(source.Format), GetTextureBlockDimension(source.Format), textureData, textureInfo.ImageSize, true, texture->Data, texture->MipLevels)) {
+			dbg::Warning("Couldn't convert streamed texture {:#06x} from Xenon to PC format.", textureInfo.NameHash);
+			return nullptr;
+		}
+	} else {
+		texture->Data.assign(textureData, textureData + textureInfo.ImageSize);
+	}
+
+	if (GetTranscodedFormat(source.Format) != source.Format) {
+		std::vector<char> transcodedData;
+		if (!TextureConverter::TranscodeTexture(texture->Width, texture->Height, texture->MipLevels, source.Format, texture->Data.data(), texture->Data.size(), transcodedData, texture->Format)) {
+			dbg::Warning("Couldn't transcode streamed texture {:#06x} from {} format.", textureInfo.NameHash, GetNFSFormatString(source.Format));
+			return nullptr;
+		}
+
+		texture->Data = std::move(transcodedData);
+	}
+
+	return texture;
+}
+
+void
+TextureStreamer::SetBudget(std::size_t budgetSize)
+{
+	std::lock_guard<std::mutex> lock(StreamLock);
+	BudgetSize = budgetSize;
+	EvictTextures();
+}
+
+std::size_t
+TextureStreamer::GetBudget()
+{
+	std::lock_guard<std::mutex> lock(StreamLock);
+	return BudgetSize;
+}
+
+// Streaming offsets are relative to the file named in the pack header. The loading file is used only
+// if that file can't be found or the offsets don't fit it (e.g. the pack is stored in the same file).
+static nfr::api::SafeInterface<nfr::api::IStream>
+OpenPackFile(const nfr::api::path& loadingFilePath, const TexturePackHeader& packHeader, const std::vector<StreamingEntry>& streamingEntries, nfr::api::path& outFilePath)
+{
+	std::int64_t requiredSize = 0;
+	for (const StreamingEntry& entry : streamingEntries) {
+		requiredSize = std::max(requiredSize, static_cast<std::int64_t>(entry.ChunkByteOffset) + entry.ChunkByteSize);
+	}
+
+	std::string packFileName(packHeader.Filename, strnlen(packHeader.Filename, sizeof(packHeader.Filename)));
+	for (char& sym : packFileName) {
+		if (sym == '\\') {
+			sym = '/';
+		}
+	}
+
+	nfr::api::path packFilePath;
+	if (!packFileName.empty()) {
+		packFilePath = EngineFactory->getGameDirectory();
+		packFilePath.append(packFileName);
+	}
+
+	for (const nfr::api::path& filePath : { packFilePath, loadingFilePath }) {
+		if (filePath.empty() || !EngineFactory->exists(filePath)) {
+			continue;
+		}
+
+		nfr::api::SafeInterface<nfr::api::IStream> stream = EngineFactory->openFile(nfr::api::EStreamFlags::ReadFlag, filePath);
+		if (stream->isOpen() && stream->getSize() >= requiredSize) {
+			if (filePath != packFilePath) {
+				dbg::Verbose("    Streamed textures of {} pack are read from the loading file.", packFileName);
+			}
+
+			outFilePath = filePath;
+			return stream;
+		}
+	}
+
+	return nullptr;
+}
+
+bool
+TextureStreamer::RegisterPack(
+	const nfr::api::path& loadingFilePath,
+	const TexturePackHeader& packHeader,
+	const std::vector<StreamingEntry>& streamingEntries,
+	const std::vector<TextureInfo>& texturesInfo,
+	const std::vector<ENFSTextureFormat>& texturesFormat,
+	bool isXenonPlatform
+)
+{
+	nfr::api::path packFilePath;
+	nfr::api::SafeInterface<nfr::api::IStream> packStream = OpenPackFile(loadingFilePath, packHeader, streamingEntries, packFilePath);
+	if (packStream.get() == nullptr) {
+		dbg::Warning("Can't find the file with streamed textures of {} pack. Skipping the pack...", packHeader.Filename);
+		return false;
+	}
+
+	std::unordered_map<std::uint32_t, std::size_t> infoIndices;
+	infoIndices.reserve(texturesInfo.size());
+	for (std::size_t i = 0; i < texturesInfo.size(); i++) {
+		infoIndices.emplace(texturesInfo[i].NameHash, i);
+	}
+
+	std::lock_guard<std::mutex> lock(StreamLock);
+	const std::uint32_t packIndex = static_cast<std::uint32_t>(Packs.size());
+	Packs.push_back(std::make_shared<StreamedPack>(std::move(packStream), packFilePath, packHeader.FilenameHash, isXenonPlatform));
+
+	std::size_t registeredCount = 0;
+	for (const StreamingEntry& entry : streamingEntries) {
+		auto it = infoIndices.find(entry.NameHash);
+		if (it == infoIndices.end()) {
+			dbg::Warning("No texture info was found for streamed texture {:#06x}. Skipping texture...", entry.NameHash);
+			continue;
+		}
+
+		if (texturesFormat[it->second] == ENFSTextureFormat::Unknown) {
+			continue;
+		}
+
+		Sources[entry.NameHash] = { packIndex, entry, texturesInfo[it->second], texturesFormat[it->second] };
+		registeredCount++;
+	}
+
+	dbg::Verbose("    Registered {} streamed textures of {} pack.", registeredCount, packHeader.Filename);
+	return registeredCount != 0;
+}
+
+bool
+TextureStreamer::IsStreamed(std::uint32_t nameHash)
+{
+	std::lock_guard<std::mutex> lock(StreamLock);
+	return Sources.find(nameHash) != Sources.end();
+}
+
+std::shared_ptr<const StreamedTexture>
+TextureStreamer::RequestTexture(std::uint32_t nameHash)
+{
+	std::shared_ptr<StreamedPack> pack;
+	StreamedTextureSource source;
+	{
+		std::lock_guard<std::mutex> lock(StreamLock);
+		auto residentIt = ResidentMap.find(nameHash);
+		if (residentIt != ResidentMap.end()) {
+			ResidentTextures.splice(ResidentTextures.begin(), ResidentTextures, residentIt->second);
+			HitsCount++;
+			return ResidentTextures.front();
+		}
+
+		auto sourceIt = Sources.find(nameHash);
+		if (sourceIt == Sources.end()) {
+			return nullptr;
+		}
+
+		source = sourceIt->second;
+		pack = Packs[source.PackIndex];
+	}
+
+	// Reading and conversion are done without lock, so different textures can be loaded in parallel
+	std::shared_ptr<const StreamedTexture> texture = LoadStreamedTexture(*pack, source);
+	if (texture == nullptr) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(StreamLock);
+	MissesCount++;
+
+	// Another thread could load the same texture meanwhile
+	auto residentIt = ResidentMap.find(nameHash);
+	if (residentIt != ResidentMap.end()) {
+		ResidentTextures.splice(ResidentTextures.begin(), ResidentTextures, residentIt->second);
+		return ResidentTextures.front();
+	}
+
+	ResidentTextures.push_front(texture);
+	ResidentMap[nameHash] = ResidentTextures.begin();
+	ResidentSize += texture->Data.size();
+	EvictTextures();
+	return texture;
+}
+
+void
+TextureStreamer::Reset()
+{
+	std::lock_guard<std::mutex> lock(StreamLock);
+	Packs.clear();
+	Sources.clear();
+	ResidentTextures.clear();
+	ResidentMap.clear();
+	ResidentSize = 0;
+	HitsCount = 0;
+	MissesCount = 0;
+	EvictionsCount = 0;
+}
+
+std::size_t
+TextureStreamer::GetResidentSize()
+{
+	std::lock_guard<std::mutex> lock(StreamLock);
+	return ResidentSize;
+}
+
+void
+TextureStreamer::LogReport()
+{
+	std::lock_guard<std::mutex> lock(StreamLock);
+	if (Sources.empty()) {
+		return;
+	}
+
+	dbg::Log("Streaming {} textures from {} packs ({} hits, {} misses, {} evictions, {} KB of {} KB resident).",
+		Sources.size(),
+		Packs.size(),
+		HitsCount,
+		MissesCount,
+		EvictionsCount,
+		ResidentSize / 1024,
+		BudgetSize / 1024
+	);
+}
+
+}
@@ -0,0 +1,74 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+#include <memory>
+
+namespace bb
+{
+
+constexpr std::size_t DefaultTextureStreamingBudget = 256 * 1024 * 1024;
+
+// Texture loaded through the streaming table and converted to PC layout (DDS layout without header)
+struct StreamedTexture
+{
+	std::uint32_t NameHash;
+	ENFSTextureFormat Format;
+	std::int32_t Width;
+	std::int32_t Height;
+	std::int32_t MipLevels;
+	std::vector<char> Data;
+};
+
+/*
+	Texture packs with streaming tables keep only their headers in memory. Every texture is read
+	from the pack file by StreamingEntry offsets on the first RequestTexture call, converted and
+	kept in the LRU list until the budget is exceeded. Evicted textures stay valid while somebody
+	holds them. The engine can't request them yet, nfr::api has no call for it.
+*/
+class TextureStreamer
+{
+public:
+	static void SetBudget(std::size_t budgetSize);
+	static std::size_t GetBudget();
+
+	// Streamed data is read from the file named in the pack header, loadingFilePath (the file which
+	// contains the pack header) is used if the offsets don't fit that file
+	static bool RegisterPack(
+		const nfr::api::path& loadingFilePath,
+		const TexturePackHeader& packHeader,
+		const std::vector<StreamingEntry>& streamingEntries,
+		const std::vector<TextureInfo>& texturesInfo,
+		const std::vector<ENFSTextureFormat>& texturesFormat,
+		bool isXenonPlatform
+	);
+
+	static bool IsStreamed(std::uint32_t nameHash);
+
+	// Returns nullptr if the texture isn't streamed or can't be loaded
+	static std::shared_ptr<const StreamedTexture> RequestTexture(std::uint32_t nameHash);
+
+	// Closes all pack files and drops the resident textures
+	static void Reset();
+
+	static std::size_t GetResidentSize();
+	static void LogReport();
+};
+
+}
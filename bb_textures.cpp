@@ -18,6 +18,7 @@
 * Boston, MA 02110-1301 USA
 *****************************************************************/
 #include "blackbox_pch.h"
+#include <mutex>
 #define STB_DXT_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
@@ -29,76 +30,416 @@
 #include "stb/stb_image_write.h"
 #include "bcdec/bcdec.h"
 
+#if BB_X86
+#include <immintrin.h>
+#endif
+
 namespace bb
 { 
 
+static constexpr std::size_t XenonSpanSize = 16;
+
+static std::int32_t
+GetXenonTileOffset(std::int32_t x, std::int32_t y, std::int32_t width, std::int32_t logBpb)
+{
+	int alignedWidth = ALIGN_VALUE(width, 32);
+	int macro = ((x >> 5) + (y >> 5) * (alignedWidth >> 5)) << (logBpb + 7);
+	int micro = ((x & 7) + ((y & 0xE) << 2)) << logBpb;
+	int offset = macro + ((micro & ~0xF) << 1) + (micro & 0xF) + ((y & 1) << 4);
+	return (((offset & ~0x1FF) << 3) +
+		((y & 16) << 7) +
+		((offset & 0x1C0) << 2) +
+		(((((y & 8) >> 2) + (x >> 3)) & 3) << 6) +
+		(offset & 0x3F)
+	) >> logBpb;
+}
+
+static std::int32_t
+IntLog2(std::int32_t n)
+{
+	std::int32_t r;
+	for (r = -1; n; n >>= 1, r++) {
+
+	}
+
+	return r;
+}
+
+static std::int32_t
+NextPowerOfTwo(std::int32_t n)
+{
+	std::int32_t r = 1;
+	while (r < n) {
+		r <<= 1;
+	}
+
+	return r;
+}
+
+// Mips with 16 texels or less on the smaller side are packed together into one tile.
+// The offset of each packed mip inside this tile depends only on its index in the tail.
+static void
+GetXenonPackedMipOffset(std::int32_t width, std::int32_t height, std::int32_t packedLevel, std::int32_t blockDimension, std::int32_t& offsetX, std::int32_t& offsetY)
+{
+	const bool isWide = IntLog2(width) > IntLog2(height);
+	offsetX = 0;
+	offsetY = 0;
+
+	if (packedLevel < 3) {
+		(isWide ? offsetY : offsetX) = 16 >> packedLevel;
+	} else {
+		(isWide ? offsetX : offsetY) = 16 >> (packedLevel - 2);
+	}
+
+	offsetX /= blockDimension;
+	offsetY /= blockDimension;
+}
+
+using UntileSpansFunction = void(*)(char* pcData, const char* xenonData, const std::uint32_t* spanOffsets, std::size_t spansCount);
+
+// Xenon stores texture data as big endian 16-bit words
+static void
+CopySwappedWords(char* pcData, const char* xenonData, std::size_t size)
+{
+	for (std::size_t i = 0; i < size; i += 2) {
+		pcData[i] = xenonData[i + 1];
+		pcData[i + 1] = xenonData[i];
+	}
+}
+
+template<bool SwapBytes>
+static void
+UntileSpansScalar(char* pcData, const char* xenonData, const std::uint32_t* spanOffsets, std::size_t spansCount)
+{
+	for (std::size_t i = 0; i < spansCount; i++) {
+		if constexpr (SwapBytes) {
+			CopySwappedWords(pcData + i * XenonSpanSize, xenonData + spanOffsets[i], XenonSpanSize);
+		} else {
+			std::memcpy(pcData + i * XenonSpanSize, xenonData + spanOffsets[i], XenonSpanSize);
+		}
+	}
+}
+
+#if BB_X86
+template<bool SwapBytes>
+BB_TARGET_SSE2 static void
+UntileSpansSSE2(char* pcData, const char* xenonData, const std::uint32_t* spanOffsets, std::size_t spansCount)
+{
+	for (std::size_t i = 0; i < spansCount; i++) {
+		__m128i span = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i]));
+		if constexpr (SwapBytes) {
+			span = _mm_or_si128(_mm_slli_epi16(span, 8), _mm_srli_epi16(span, 8));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pcData + i * XenonSpanSize), span);
+	}
+}
+
+BB_TARGET_SSSE3 static void
+UntileSpansSSSE3(char* pcData, const char* xenonData, const std::uint32_t* spanOffsets, std::size_t spansCount)
+{
+	const __m128i swapMask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	std::size_t i = 0;
+	for (; i + 4 <= spansCount; i += 4) {
+		__m128i span0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 0]));
+		__m128i span1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 1]));
+		__m128i span2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 2]));
+		__m128i span3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pcData + (i + 0) * XenonSpanSize), _mm_shuffle_epi8(span0, swapMask));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pcData + (i + 1) * XenonSpanSize), _mm_shuffle_epi8(span1, swapMask));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pcData + (i + 2) * XenonSpanSize), _mm_shuffle_epi8(span2, swapMask));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pcData + (i + 3) * XenonSpanSize), _mm_shuffle_epi8(span3, swapMask));
+	}
+
+	for (; i < spansCount; i++) {
+		__m128i span = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pcData + i * XenonSpanSize), _mm_shuffle_epi8(span, swapMask));
+	}
+}
+
+template<bool SwapBytes>
+BB_TARGET_AVX2 static void
+UntileSpansAVX2(char* pcData, const char* xenonData, const std::uint32_t* spanOffsets, std::size_t spansCount)
+{
+	const __m256i swapMask = _mm256_setr_epi8(
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+	);
+
+	std::size_t i = 0;
+	for (; i + 4 <= spansCount; i += 4) {
+		__m256i spans01 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 0]))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 1])), 1
+		);
+		__m256i spans23 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 2]))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i + 3])), 1
+		);
+
+		if constexpr (SwapBytes) {
+			spans01 = _mm256_shuffle_epi8(spans01, swapMask);
+			spans23 = _mm256_shuffle_epi8(spans23, swapMask);
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pcData + i * XenonSpanSize), spans01);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pcData + (i + 2) * XenonSpanSize), spans23);
+	}
+
+	for (; i < spansCount; i++) {
+		__m128i span = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xenonData + spanOffsets[i]));
+		if constexpr (SwapBytes) {
+			span = _mm_shuffle_epi8(span, _mm256_castsi256_si128(swapMask));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pcData + i * XenonSpanSize), span);
+	}
+}
+#endif
+
+static UntileSpansFunction
+GetUntileSpansFunction(bool swapBytes)
+{
+#if BB_X86
+	const CpuFeatures& cpuFeatures = GetCpuFeatures();
+	if (cpuFeatures.AVX2) {
+		return swapBytes ? UntileSpansAVX2<true> : UntileSpansAVX2<false>;
+	}
+
+	if (swapBytes && cpuFeatures.SSSE3) {
+		return UntileSpansSSSE3;
+	}
+
+	if (cpuFeatures.SSE2) {
+		return swapBytes ? UntileSpansSSE2<true> : UntileSpansSSE2<false>;
+	}
+#endif
+
+	return swapBytes ? UntileSpansScalar<true> : UntileSpansScalar<false>;
+}
+
+static std::shared_ptr<const XenonUntileTable>
+BuildXenonUntileTable(std::int32_t width, std::int32_t height, std::int32_t mipLevels, std::int32_t blockSize, std::int32_t blockDimension)
+{
+	std::shared_ptr<XenonUntileTable> table = std::make_shared<XenonUntileTable>();
+	const std::int32_t logBpb = IntLog2(blockSize);
+	const std::int32_t tiledWidth = NextPowerOfTwo(width);
+	const std::int32_t tiledHeight = NextPowerOfTwo(height);
+
+	std::size_t tiledOffset = 0;
+	std::size_t linearOffset = 0;
+	std::size_t packedOffset = 0;
+	std::int32_t packedBlockWidth = 0;
+	std::int32_t packedBlockHeight = 0;
+	std::int32_t packedLevel = -1;
+
+	table->Levels.reserve(mipLevels);
+	for (std::int32_t level = 0; level < mipLevels; level++) {
+		const std::int32_t levelWidth = std::max(1, width >> level);
+		const std::int32_t levelHeight = std::max(1, height >> level);
+		const std::int32_t levelTiledWidth = std::max(1, tiledWidth >> level);
+		const std::int32_t levelTiledHeight = std::max(1, tiledHeight >> level);
+		const std::int32_t blockWidth = (levelWidth + blockDimension - 1) / blockDimension;
+		const std::int32_t blockHeight = (levelHeight + blockDimension - 1) / blockDimension;
+
+		// Only mip levels are padded to the power of two, the base level is aligned to 32 blocks
+		std::size_t levelOffset = tiledOffset;
+		const std::int32_t pitchBlockWidth = level == 0 ? blockWidth : (levelTiledWidth + blockDimension - 1) / blockDimension;
+		const std::int32_t pitchBlockHeight = level == 0 ? blockHeight : (levelTiledHeight + blockDimension - 1) / blockDimension;
+		std::int32_t tiledBlockWidth = ALIGN_VALUE(pitchBlockWidth, 32);
+		std::int32_t tiledBlockHeight = ALIGN_VALUE(pitchBlockHeight, 32);
+		std::int32_t offsetX = 0;
+		std::int32_t offsetY = 0;
+
+		if (std::min(levelTiledWidth, levelTiledHeight) <= 16) {
+			if (packedLevel < 0) {
+				packedOffset = tiledOffset;
+				packedBlockWidth = tiledBlockWidth;
+				packedBlockHeight = tiledBlockHeight;
+				tiledOffset += static_cast<std::size_t>(packedBlockWidth) * packedBlockHeight * blockSize;
+			}
+
+			packedLevel++;
+			GetXenonPackedMipOffset(levelTiledWidth, levelTiledHeight, packedLevel, blockDimension, offsetX, offsetY);
+			levelOffset = packedOffset;
+			tiledBlockWidth = packedBlockWidth;
+			tiledBlockHeight = packedBlockHeight;
+		} else {
+			tiledOffset += static_cast<std::size_t>(tiledBlockWidth) * tiledBlockHeight * blockSize;
+		}
+
+		XenonUntileLevel& levelInfo = table->Levels.emplace_back();
+		levelInfo.Width = levelWidth;
+		levelInfo.Height = levelHeight;
+		levelInfo.LinearOffset = linearOffset;
+		levelInfo.LinearSize = static_cast<std::size_t>(blockWidth) * blockHeight * blockSize;
+		levelInfo.TiledEnd = levelOffset + static_cast<std::size_t>(tiledBlockWidth) * tiledBlockHeight * blockSize;
+		levelInfo.FirstBlock = table->SourceOffsets.size();
+		levelInfo.FirstSpan = table->SpanOffsets.size();
+		levelInfo.SpansCount = 0;
+		linearOffset += levelInfo.LinearSize;
+
+		for (std::int32_t dy = 0; dy < blockHeight; dy++) {
+			for (std::int32_t dx = 0; dx < blockWidth; dx++) {
+				const std::int32_t swzAddr = GetXenonTileOffset(dx + offsetX, dy + offsetY, tiledBlockWidth, logBpb);
+				assert(swzAddr < tiledBlockWidth * tiledBlockHeight);
+				table->SourceOffsets.push_back(static_cast<std::uint32_t>(levelOffset + static_cast<std::size_t>(swzAddr) * blockSize));
+			}
+		}
+
+		// Xenon keeps 16 bytes of every micro tile row together, so BC1 blocks are going in pairs
+		const std::size_t spanBlocks = XenonSpanSize / blockSize;
+		if (XenonSpanSize % blockSize != 0 || levelInfo.LinearSize % XenonSpanSize != 0) {
+			continue;
+		}
+
+		const std::uint32_t* levelOffsets = table->SourceOffsets.data() + levelInfo.FirstBlock;
+		const std::size_t levelBlocks = levelInfo.LinearSize / blockSize;
+		bool isContiguous = true;
+		for (std::size_t i = 0; i < levelBlocks && isContiguous; i += spanBlocks) {
+			for (std::size_t j = 1; j < spanBlocks; j++) {
+				if (levelOffsets[i + j] != levelOffsets[i] + j * blockSize) {
+					isContiguous = false;
+					break;
+				}
+			}
+		}
+
+		if (isContiguous) {
+			for (std::size_t i = 0; i < levelBlocks; i += spanBlocks) {
+				table->SpanOffsets.push_back(levelOffsets[i]);
+			}
+
+			levelInfo.SpansCount = levelBlocks / spanBlocks;
+		}
+	}
+
+	return table;
+}
+
+std::shared_ptr<const XenonUntileTable>
+TextureConverter::GetXenonUntileTable(std::int32_t width, std::int32_t height, std::int32_t mipLevels, std::int32_t blockSize, std::int32_t blockDimension)
+{
+	static std::mutex tablesLock;
+	static std::unordered_map<std::uint64_t, std::shared_ptr<const XenonUntileTable>> tablesCache;
+
+	const std::uint64_t tableKey = (static_cast<std::uint64_t>(width & 0xFFFF) << 48) |
+		(static_cast<std::uint64_t>(height & 0xFFFF) << 32) |
+		(static_cast<std::uint64_t>(mipLevels & 0xFFFF) << 16) |
+		(static_cast<std::uint64_t>(blockDimension & 0xFF) << 8) |
+		static_cast<std::uint64_t>(blockSize & 0xFF);
+
+	{
+		std::lock_guard<std::mutex> lock(tablesLock);
+		auto it = tablesCache.find(tableKey);
+		if (it != tablesCache.end()) {
+			return it->second;
+		}
+	}
+
+	std::shared_ptr<const XenonUntileTable> table = BuildXenonUntileTable(width, height, mipLevels, blockSize, blockDimension);
+	std::lock_guard<std::mutex> lock(tablesLock);
+	return tablesCache.emplace(tableKey, std::move(table)).first->second;
+}
+
 bool
 TextureConverter::UntileXenonTexture(
 	std::int32_t width,
 	std::int32_t height, 
 	std::int32_t mipLevels,
 	std::int32_t blockSize,
+	std::int32_t blockDimension,
 	const char* xenonData,
-	char* pcData
+	std::size_t xenonDataSize,
+	bool swapBytes,
+	std::vector<char>& pcData,
+	std::int32_t& outMipLevels
 )
 {
-	// #TODO: Untiling for multiple miplevels
-	auto GetXenonTileOffset = [](std::int32_t x, std::int32_t y, std::int32_t width, std::int32_t logBpb) {
-		int alignedWidth = ALIGN_VALUE(width, 32);
-		int macro = ((x >> 5) + (y >> 5) * (alignedWidth >> 5)) << (logBpb + 7);
-		int micro = ((x & 7) + ((y & 0xE) << 2)) << logBpb;
-		int offset = macro + ((micro & ~0xF) << 1) + (micro & 0xF) + ((y & 1) << 4);
-		return (((offset & ~0x1FF) << 3) +
-			((y & 16) << 7) +
-			((offset & 0x1C0) << 2) +
-			(((((y & 8) >> 2) + (x >> 3)) & 3) << 6) +
-			(offset & 0x3F)
-		) >> logBpb;
-	};
+	if (width <= 0 || height <= 0 || blockSize <= 0 || blockDimension <= 0) {
+		return false;
+	}
 
-	auto intLog2 = [](int n) {
-		int r;
-		for (r = -1; n; n >>= 1, r++) {
+	// Pixels of one 16-bit word are going to different places, so the data is swapped before untiling
+	std::vector<char> swappedData;
+	if (swapBytes && blockSize < 2) {
+		swappedData.resize(xenonDataSize & ~static_cast<std::size_t>(1));
+		CopySwappedWords(swappedData.data(), xenonData, swappedData.size());
+		xenonData = swappedData.data();
+		xenonDataSize = swappedData.size();
+		swapBytes = false;
+	}
+
+	const std::int32_t maxMipLevels = IntLog2(std::max(width, height)) + 1;
+	mipLevels = std::clamp(mipLevels, 1, maxMipLevels);
 
+	std::shared_ptr<const XenonUntileTable> table = GetXenonUntileTable(width, height, mipLevels, blockSize, blockDimension);
+
+	std::int32_t levelsCount = 0;
+	for (const XenonUntileLevel& level : table->Levels) {
+		if (level.TiledEnd > xenonDataSize) {
+			break;
 		}
 
-		return r;
-	};
+		levelsCount++;
+	}
 
-	const std::int32_t textureAlign = 128;
-	const std::int32_t alignedWidth = ALIGN_VALUE(width, textureAlign);
-	const std::int32_t alignedHeight = ALIGN_VALUE(height, textureAlign);
-	const std::int32_t tiledBlockWidth = alignedWidth / 4;
-	const std::int32_t originalBlockWidth = width / 4;
-	const std::int32_t tiledBlockHeight = alignedHeight / 4;
-	const std::int32_t originalBlockHeight = height / 4;
-	const std::int32_t logBpp = intLog2(blockSize);
+	if (levelsCount == 0) {
+		dbg::Warning("Xenon texture data is too small ({} bytes) for {}x{} texture.", xenonDataSize, width, height);
+		return false;
+	}
 
-	std::int32_t sxOffset = 0;
-	std::int32_t syOffset = 0;
-	if ((tiledBlockWidth >= originalBlockWidth * 2) && (width == 16)) {
-		sxOffset = originalBlockWidth;
+	// The GPU reads mip levels from a separate address, so the chain is trusted only if the data
+	// size matches mip levels placed right after the base level. Otherwise they are generated again.
+	if (levelsCount > 1) {
+		const std::size_t chainSize = table->Levels[levelsCount - 1].TiledEnd;
+		if (levelsCount < static_cast<std::int32_t>(table->Levels.size()) || (xenonDataSize != chainSize && xenonDataSize != ALIGN_VALUE(chainSize, 4096))) {
+			levelsCount = 1;
+		}
 	}
 
-	if ((tiledBlockHeight >= originalBlockHeight * 2) && (height == 16)) {
-		syOffset = originalBlockHeight;
+	if (levelsCount < static_cast<std::int32_t>(table->Levels.size())) {
+		dbg::Verbose("        Only {} of {} mip levels are taken from texture data", levelsCount, table->Levels.size());
 	}
 
-	std::int32_t numImageBlocks = tiledBlockWidth * tiledBlockHeight;
-	int bytesPerBlock = blockSize;
-	for (int dy = 0; dy < originalBlockHeight; dy++) {
-		for (int dx = 0; dx < originalBlockWidth; dx++) {
-			std::uint32_t swzAddr = GetXenonTileOffset(dx + sxOffset, dy + syOffset, tiledBlockWidth, logBpp);
-			assert(swzAddr < numImageBlocks);
-			std::int32_t sy = swzAddr / tiledBlockWidth;
-			std::int32_t sx = swzAddr % tiledBlockWidth;
+	static const UntileSpansFunction untileSpansFunctions[2] = { GetUntileSpansFunction(false), GetUntileSpansFunction(true) };
+	const UntileSpansFunction untileSpans = untileSpansFunctions[swapBytes ? 1 : 0];
+	const XenonUntileLevel& lastLevel = table->Levels[levelsCount - 1];
+	pcData.resize(lastLevel.LinearOffset + lastLevel.LinearSize);
+
+	for (std::int32_t i = 0; i < levelsCount; i++) {
+		const XenonUntileLevel& level = table->Levels[i];
+		char* pDst = pcData.data() + level.LinearOffset;
+		if (level.SpansCount != 0) {
+			untileSpans(pDst, xenonData, table->SpanOffsets.data() + level.FirstSpan, level.SpansCount);
+			continue;
+		}
+
+		// Small mips from packed tail are going block by block
+		const std::uint32_t* sourceOffsets = table->SourceOffsets.data() + level.FirstBlock;
+		const std::size_t blocksCount = level.LinearSize / blockSize;
+		for (std::size_t j = 0; j < blocksCount; j++) {
+			if (swapBytes) {
+				CopySwappedWords(pDst, xenonData + sourceOffsets[j], blockSize);
+			} else {
+				std::memcpy(pDst, xenonData + sourceOffsets[j], blockSize);
+			}
+
+			pDst += blockSize;
+		}
+	}
 
-			char* pDst = pcData + (dy * originalBlockWidth + dx) * bytesPerBlock;
-			const char* pSrc = xenonData + (sy * tiledBlockWidth + sx) * bytesPerBlock;
-			std::memcpy(pDst, pSrc, bytesPerBlock);
+	// 32-bit pixels are big endian as a whole, so the swapped 16-bit halves are exchanged too
+	if (swapBytes && blockDimension == 1 && blockSize == 4) {
+		for (std::size_t i = 0; i + 4 <= pcData.size(); i += 4) {
+			std::uint32_t pixel = 0;
+			std::memcpy(&pixel, pcData.data() + i, 4);
+			pixel = (pixel >> 16) | (pixel << 16);
+			std::memcpy(pcData.data() + i, &pixel, 4);
 		}
 	}
 
+	outMipLevels = levelsCount;
 	return true;
 }
 
@@ -118,33 +459,40 @@ TextureConverter::DecodeTexture(
 	case ENFSTextureFormat::BC1:
 	case ENFSTextureFormat::BC2:
 	case ENFSTextureFormat::BC3: {
-		const std::int32_t blockSize = formatToDecode == ENFSTextureFormat::BC1 ? BCDEC_BC1_BLOCK_SIZE : BCDEC_BC3_BLOCK_SIZE;
-		std::uint64_t blockOffset = 0;
-		std::uint64_t textureOffset = 0;
-
-		// BC block contains 16 pixels in 16 bytes, so in unpacked way
-		// we're getting 64 bytes on raw RGBA data
-		rawData.resize(codedDataSize * 4);
-
-		for (std::uint32_t y = 0; y < height / 4; y++) {
-			for (std::uint32_t x = 0; x < width / 4; x++) {
-				const char* shiftedSrcPtr = codedData + textureOffset;
-				char* shiftedDstPtr = rawData.data() + (y * width + x) * 4 * 4;
-				switch (formatToDecode) {
-				case ENFSTextureFormat::BC1:
-					bcdec_bc1(shiftedSrcPtr, shiftedDstPtr, width * 4 /* RGBA */);
-					break;
-				case ENFSTextureFormat::BC2:
-					bcdec_bc2(shiftedSrcPtr, shiftedDstPtr, width * 4 /* RGBA */);
-					break;
-				case ENFSTextureFormat::BC3:
-					bcdec_bc3(shiftedSrcPtr, shiftedDstPtr, width * 4 /* RGBA */);
-					break;
-				default:
-					break;
-				}
+		const std::size_t blockSize = formatToDecode == ENFSTextureFormat::BC1 ? BCDEC_BC1_BLOCK_SIZE : BCDEC_BC3_BLOCK_SIZE;
+		const std::size_t blocksWidth = (static_cast<std::size_t>(width) + 3) / 4;
+		const std::size_t blocksHeight = (static_cast<std::size_t>(height) + 3) / 4;
+		if (width <= 0 || height <= 0 || codedDataSize < blocksWidth * blocksHeight * blockSize) {
+			dbg::Error("Not enough data to decode {}x{} texture ({} bytes).", width, height, codedDataSize);
+			return false;
+		}
 
-				textureOffset += blockSize;
+		// Every block gives 4x4 RGBA8 pixels. Textures with sizes not divisible by 4
+		// are decoded into the block aligned buffer and cropped after that.
+		const std::size_t pitch = static_cast<std::size_t>(width) * 4;
+		const std::size_t alignedPitch = blocksWidth * 16;
+		const bool isAligned = alignedPitch == pitch && blocksHeight * 4 == static_cast<std::size_t>(height);
+		std::vector<char> alignedData;
+		rawData.resize(pitch * height);
+		char* decodedPtr = rawData.data();
+		if (!isAligned) {
+			alignedData.resize(alignedPitch * blocksHeight * 4);
+			decodedPtr = alignedData.data();
+		}
+
+		// Groups of block rows are decoded in parallel, small textures are decoded on the calling thread
+		constexpr std::size_t rowsPerJob = 8;
+		const std::size_t jobsCount = (blocksHeight + rowsPerJob - 1) / rowsPerJob;
+		ThreadPool::ParallelFor(jobsCount, [&](std::size_t jobIndex) {
+			const std::size_t lastRow = std::min(blocksHeight, (jobIndex + 1) * rowsPerJob);
+			for (std::size_t y = jobIndex * rowsPerJob; y < lastRow; y++) {
+				DecodeBCBlocksRow(formatToDecode, codedData + y * blocksWidth * blockSize, blocksWidth, decodedPtr + y * 4 * alignedPitch, alignedPitch);
+			}
+		});
+
+		if (!isAligned) {
+			for (std::int32_t y = 0; y < height; y++) {
+				std::memcpy(rawData.data() + y * pitch, alignedData.data() + y * alignedPitch, pitch);
 			}
 		}
 
@@ -152,6 +500,26 @@ TextureConverter::DecodeTexture(
 	}
 							   break;
 
+	case ENFSTextureFormat::BGRA8: {
+		const std::size_t dataSize = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 4;
+		if (width <= 0 || height <= 0 || codedDataSize < dataSize) {
+			dbg::Error("Not enough data to decode {}x{} texture ({} bytes).", width, height, codedDataSize);
+			return false;
+		}
+
+		// Only red and blue channels are swapped, only the top level is decoded as for BC formats
+		rawData.resize(dataSize);
+		for (std::size_t i = 0; i < dataSize; i += 4) {
+			rawData[i] = codedData[i + 2];
+			rawData[i + 1] = codedData[i + 1];
+			rawData[i + 2] = codedData[i];
+			rawData[i + 3] = codedData[i + 3];
+		}
+
+		outFormat = ENFSTextureFormat::RGBA8;
+	}
+							   break;
+
 	default:
 		break;
 	}
@@ -171,9 +539,16 @@ std::uint32_t GetTextureBlockSize(ENFSTextureFormat textureFormat)
 		return BCDEC_BC2_BLOCK_SIZE;
 	case ENFSTextureFormat::BC3:
 		return BCDEC_BC3_BLOCK_SIZE;
+	case ENFSTextureFormat::BC4:
+	case ENFSTextureFormat::DXT3A:
+	case ENFSTextureFormat::CTX1:
+		return 8;
+	case ENFSTextureFormat::BC5:
+		return 16;
     case ENFSTextureFormat::F16:
         return 2;
     case ENFSTextureFormat::RGBA8:
+    case ENFSTextureFormat::BGRA8:
         return 4;
     case ENFSTextureFormat::R8:
         return 1;
@@ -186,6 +561,40 @@ std::uint32_t GetTextureBlockSize(ENFSTextureFormat textureFormat)
 	return 0;
 }
 
+std::int32_t GetTextureBlockDimension(ENFSTextureFormat textureFormat)
+{
+	switch (textureFormat) {
+	case ENFSTextureFormat::BC1:
+	case ENFSTextureFormat::BC2:
+	case ENFSTextureFormat::BC3:
+	case ENFSTextureFormat::BC4:
+	case ENFSTextureFormat::BC5:
+	case ENFSTextureFormat::DXT3A:
+	case ENFSTextureFormat::CTX1:
+		return 4;
+	default:
+		break;
+	}
+
+	return 1;
+}
+
+// Size of one mip level in bytes, BC formats are stored by 4x4 blocks
+static std::size_t
+GetMipLevelSize(ENFSTextureFormat format, std::int32_t width, std::int32_t height)
+{
+	const std::size_t levelWidth = static_cast<std::size_t>(std::max(1, width));
+	const std::size_t levelHeight = static_cast<std::size_t>(std::max(1, height));
+	const std::size_t blockDimension = GetTextureBlockDimension(format);
+	return ((levelWidth + blockDimension - 1) / blockDimension) * ((levelHeight + blockDimension - 1) / blockDimension) * GetTextureBlockSize(format);
+}
+
+static std::int32_t
+GetFullMipLevelsCount(std::int32_t width, std::int32_t height)
+{
+	return IntLog2(std::max(1, std::max(width, height))) + 1;
+}
+
 TextureInformation GetTextureInfoFromDDS(const DDS_HEADER& ddsHeader)
 {
 	TextureInformation outInformation = {};
@@ -200,52 +609,175 @@ TextureInformation GetTextureInfoFromDDS(const DDS_HEADER& ddsHeader)
 	case FOURCC_DXT5:
 		outInformation.Format = ENFSTextureFormat::BC3;
 		break;
+	case FOURCC_ATI1:
+		outInformation.Format = ENFSTextureFormat::BC4;
+		break;
+	case FOURCC_ATI2:
+		outInformation.Format = ENFSTextureFormat::BC5;
+		break;
 	default:
 		break;
 	}
 
+	// Uncompressed formats are recognized by all channel masks, other layouts (A8, A8L8, X8R8G8B8...) stay unknown
+	if (!(ddsHeader.ddspf.dwFlags & DDPF_FOURCC)) {
+		const DDS_PIXELFORMAT& pixelFormat = ddsHeader.ddspf;
+		auto hasLayout = [&pixelFormat](std::uint32_t bitCount, std::uint32_t rMask, std::uint32_t gMask, std::uint32_t bMask, std::uint32_t aMask) {
+			return pixelFormat.dwRGBBitCount == bitCount && pixelFormat.dwRBitMask == rMask && pixelFormat.dwGBitMask == gMask &&
+				pixelFormat.dwBBitMask == bMask && pixelFormat.dwABitMask == aMask;
+		};
+
+		if (hasLayout(32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000)) {
+			outInformation.Format = ENFSTextureFormat::BGRA8;
+		} else if (hasLayout(32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000)) {
+			outInformation.Format = ENFSTextureFormat::RGBA8;
+		} else if (hasLayout(16, 0x000000FF, 0x0000FF00, 0, 0)) {
+			outInformation.Format = ENFSTextureFormat::RG8;
+		} else if (hasLayout(8, 0x000000FF, 0, 0, 0)) {
+			outInformation.Format = ENFSTextureFormat::R8;
+		}
+	}
+
 	outInformation.Width = ddsHeader.dwWidth;
 	outInformation.Height = ddsHeader.dwHeight;
-	outInformation.MipLevels = ddsHeader.dwMipMapCount;
+	outInformation.MipLevels = std::max<std::uint32_t>(1, ddsHeader.dwMipMapCount);
 	return outInformation;
 }
 
 std::uint64_t CalculateTextureSize(ENFSTextureFormat format, std::uint32_t width, std::uint32_t height, std::uint32_t mipLevels)
 {
+	// Every level is half of the previous one on each side (but not less than 1 pixel)
 	std::uint64_t outTextureSize = 0;
-	std::uint64_t baseTextureSize = 0;
+	for (std::uint32_t i = 0; i < std::max<std::uint32_t>(1, mipLevels); i++) {
+		outTextureSize += GetMipLevelSize(format, static_cast<std::int32_t>(width >> i), static_cast<std::int32_t>(height >> i));
+	}
+
+	return outTextureSize;
+}
+
+bool
+TextureConverter::ParseDDSTexture(const char* fileData, std::size_t fileSize, DDSTextureView& outView)
+{
+	constexpr std::size_t dataOffset = 4 + sizeof(DDS_HEADER);
+	if (fileSize < dataOffset || std::memcmp(fileData, "DDS ", 4) != 0) {
+		dbg::Warning("File can't contain DDS header because it's smaller than {} bytes or has wrong magic word.", dataOffset);
+		return false;
+	}
+
+	DDS_HEADER ddsHeader = {};
+	std::memcpy(&ddsHeader, fileData + 4, sizeof(DDS_HEADER));
+	if (ddsHeader.dwSize != sizeof(DDS_HEADER) || ddsHeader.ddspf.dwSize != sizeof(DDS_PIXELFORMAT)) {
+		dbg::Warning("DDS header has wrong size ({} bytes, pixel format {} bytes).", ddsHeader.dwSize, ddsHeader.ddspf.dwSize);
+		return false;
+	}
 
+	if (ddsHeader.dwWidth == 0 || ddsHeader.dwHeight == 0 || ddsHeader.dwWidth > 0x7FFF || ddsHeader.dwHeight > 0x7FFF) {
+		dbg::Warning("DDS texture has unsupported size {}x{}.", ddsHeader.dwWidth, ddsHeader.dwHeight);
+		return false;
+	}
+
+	TextureInformation information = GetTextureInfoFromDDS(ddsHeader);
+	if (information.Format == ENFSTextureFormat::Unknown) {
+		dbg::Warning("DDS texture has unsupported pixel format (FourCC {:#010x}).", ddsHeader.ddspf.dwFourCC);
+		return false;
+	}
+
+	const std::int32_t mipLevels = std::min<std::int32_t>(information.MipLevels, GetFullMipLevelsCount(information.Width, information.Height));
+	outView.Levels.clear();
+	outView.Levels.reserve(mipLevels);
+
+	std::size_t levelOffset = dataOffset;
+	for (std::int32_t i = 0; i < mipLevels; i++) {
+		TextureLevelView levelView = {};
+		levelView.Width = std::max(1, information.Width >> i);
+		levelView.Height = std::max(1, information.Height >> i);
+		levelView.Size = GetMipLevelSize(information.Format, levelView.Width, levelView.Height);
+		if (levelView.Size > fileSize - levelOffset) {
+			dbg::Warning("DDS file is truncated, only {} of {} mip levels are present.", i, mipLevels);
+			break;
+		}
+
+		levelView.Data = fileData + levelOffset;
+		levelOffset += levelView.Size;
+		outView.Levels.emplace_back(levelView);
+	}
+
+	if (outView.Levels.empty()) {
+		return false;
+	}
+
+	information.MipLevels = static_cast<std::int16_t>(outView.Levels.size());
+	outView.Information = information;
+	return true;
+}
+
+bool
+TextureConverter::MapDDSFile(const nfr::api::path& filePath, MappedFile& mappedFile, DDSTextureView& outView)
+{
+	if (!mappedFile.open(filePath)) {
+		dbg::Warning("Can't map \"{}\" file to memory.", filePath.generic_string());
+		return false;
+	}
+
+	if (!ParseDDSTexture(mappedFile.getData(), mappedFile.getSize(), outView)) {
+		mappedFile.close();
+		return false;
+	}
+
+	return true;
+}
+
+bool
+TextureConverter::DecodeTextureLevel(const DDSTextureView& textureView, std::int32_t level, std::vector<char>& rawData)
+{
+	if (level < 0 || level >= static_cast<std::int32_t>(textureView.Levels.size())) {
+		return false;
+	}
+
+	const ENFSTextureFormat format = textureView.Information.Format;
+	const TextureLevelView& levelView = textureView.Levels[level];
 	switch (format) {
 	case ENFSTextureFormat::BC1:
-		baseTextureSize = BCDEC_BC1_COMPRESSED_SIZE(width, height);
-		break;
 	case ENFSTextureFormat::BC2:
-		baseTextureSize = BCDEC_BC2_COMPRESSED_SIZE(width, height);
-		break;
-	case ENFSTextureFormat::BC3:
-		baseTextureSize = BCDEC_BC3_COMPRESSED_SIZE(width, height);
-		break;
-	case ENFSTextureFormat::F16:
-		baseTextureSize = width * height * sizeof(short);
-		break;
+	case ENFSTextureFormat::BC3: {
+		ENFSTextureFormat decodedFormat = ENFSTextureFormat::Unknown;
+		return DecodeTexture(levelView.Width, levelView.Height, GetTextureBlockSize(format), format, levelView.Data, levelView.Size, rawData, decodedFormat);
+	}
+
 	case ENFSTextureFormat::RGBA8:
-		baseTextureSize = width * height * sizeof(std::uint32_t);
-		break;
-	case ENFSTextureFormat::RG8:
-		baseTextureSize = width * height * sizeof(std::uint16_t);
-		break;
-	case ENFSTextureFormat::R8:
-		baseTextureSize = width * height * sizeof(std::uint8_t);
-		break;
+		rawData.assign(levelView.Data, levelView.Data + levelView.Size);
+		return true;
+
+	case ENFSTextureFormat::BGRA8:
+		rawData.resize(levelView.Size);
+		for (std::size_t i = 0; i < levelView.Size; i += 4) {
+			rawData[i] = levelView.Data[i + 2];
+			rawData[i + 1] = levelView.Data[i + 1];
+			rawData[i + 2] = levelView.Data[i];
+			rawData[i + 3] = levelView.Data[i + 3];
+		}
+
+		return true;
+
 	default:
 		break;
 	}
 
-	for (std::uint32_t i = 0; i < mipLevels; i++) {
-		outTextureSize += baseTextureSize / (i + 1);
+	dbg::Warning("Can't decode texture in {} format.", GetNFSFormatString(format));
+	return false;
+}
+
+static bool
+ReadWholeStream(nfr::api::IStream* file, std::vector<char>& fileData)
+{
+	const std::int64_t fileSize = file->getSize();
+	if (fileSize <= 0) {
+		return false;
 	}
 
-	return outTextureSize;
+	fileData.resize(static_cast<std::size_t>(fileSize));
+	file->seek(nfr::api::EStreamMode::Set, 0);
+	return file->read(fileData.data(), fileSize) == fileSize;
 }
 
 bool
@@ -255,18 +787,16 @@ TextureConverter::LoadTextureFromDDSFile(
 	TextureInformation& outInformation
 )
 {
-	if (file->getSize() < 128) {
-		dbg::Warning("File can't contain DDS header because it's smaller than 128 bytes.");
+	std::vector<char> fileData;
+	DDSTextureView textureView;
+	if (!ReadWholeStream(file, fileData) || !ParseDDSTexture(fileData.data(), fileData.size(), textureView)) {
 		return false;
 	}
 
-	DDS_HEADER ddsHeader = {};
-	file->read(&ddsHeader, sizeof(DDS_HEADER));
-	outInformation = GetTextureInfoFromDDS(ddsHeader);
-
-	rawData.resize(CalculateTextureSize(outInformation.Format, outInformation.Width, outInformation.Height, outInformation.MipLevels));
-	file->read(rawData.data(), rawData.size());
-
+	// Levels are going one by one right after the header
+	const TextureLevelView& lastLevel = textureView.Levels.back();
+	rawData.assign(textureView.Levels.front().Data, lastLevel.Data + lastLevel.Size);
+	outInformation = textureView.Information;
 	return true;
 }
 
@@ -277,12 +807,13 @@ TextureConverter::LoadRawTextureFromFile(
 	TextureInformation& outInformation
 )
 {
-	ENFSTextureFormat inFormat = ENFSTextureFormat::Unknown;
-	ENFSTextureFileFormat fileFormat = ENFSTextureFileFormat::Unknown;
-	char magicWord[4] = {};
+	std::vector<char> fileData;
+	if (!ReadWholeStream(file, fileData)) {
+		return false;
+	}
 
-	file->read(magicWord, 4);
-	if (!memcmp(magicWord, "DDS ", 4)) {
+	ENFSTextureFileFormat fileFormat = ENFSTextureFileFormat::Unknown;
+	if (fileData.size() >= 4 && !memcmp(fileData.data(), "DDS ", 4)) {
 		fileFormat = ENFSTextureFileFormat::DDS;
 	}
 
@@ -293,55 +824,241 @@ TextureConverter::LoadRawTextureFromFile(
 
 	switch (fileFormat) {
 	case ENFSTextureFileFormat::DDS: {
-		DDS_HEADER ddsHeader = {};
-		char readBuffer[4096] = {};
-		file->read(&ddsHeader, sizeof(DDS_HEADER));
-		outInformation = GetTextureInfoFromDDS(ddsHeader);
+		DDSTextureView textureView;
+		if (!ParseDDSTexture(fileData.data(), fileData.size(), textureView) || !DecodeTextureLevel(textureView, 0, rawData)) {
+			return false;
+		}
 
-		std::uint32_t blockSize = GetTextureBlockSize(outInformation.Format);
-		std::uint64_t readedSize = 0;
+		outInformation = textureView.Information;
+		outInformation.Format = ENFSTextureFormat::RGBA8;
+		outInformation.MipLevels = 1;
+	}
+	break;
 
-		rawData.resize(CalculateTextureSize(ENFSTextureFormat::RGBA8, outInformation.Width, outInformation.Height, outInformation.MipLevels));
+	case ENFSTextureFileFormat::PNG:
+		break;
+	case ENFSTextureFileFormat::JPG:
+		break;
+	default:
+		break;
+	}
 
-		std::uint32_t texturePosition = 0;
-		while (!file->isEndOfFile()) {
-			readedSize = file->read(readBuffer, 4096);
-			if (readedSize == 0) {
-				break;
-			}
+	return true;
+}
 
-			for (std::uint32_t i = 0; i < readedSize; i += blockSize) {
-				switch (inFormat) {
-				case ENFSTextureFormat::BC1:
-					bcdec_bc1(&readBuffer[i], &rawData[texturePosition], outInformation.Width * 4);
-					break;
-				case ENFSTextureFormat::BC2:
-					bcdec_bc2(&readBuffer[i], &rawData[texturePosition], outInformation.Width * 4);
-					break;
-				case ENFSTextureFormat::BC3:
-					bcdec_bc3(&readBuffer[i], &rawData[texturePosition], outInformation.Width * 4);
-					break;
-				default:
-					break;
+static void
+EncodeBCLevel(ENFSTextureFormat format, std::int32_t width, std::int32_t height, const std::uint8_t* pixels, std::uint8_t* blocks)
+{
+	const bool hasAlpha = format == ENFSTextureFormat::BC3;
+	const std::size_t blockSize = GetTextureBlockSize(format);
+	const std::int32_t blocksWidth = (width + 3) / 4;
+	const std::int32_t blocksHeight = (height + 3) / 4;
+
+	// Every block row is encoded independently
+	ThreadPool::ParallelFor(blocksHeight, [&](std::size_t blockY) {
+		std::uint8_t blockPixels[4 * 4 * 4];
+		for (std::int32_t blockX = 0; blockX < blocksWidth; blockX++) {
+			const std::int32_t startX = blockX * 4;
+			for (std::int32_t y = 0; y < 4; y++) {
+				// Edge blocks of textures with sizes not divisible by 4 repeat the last row and column
+				const std::int32_t sourceY = std::min(static_cast<std::int32_t>(blockY) * 4 + y, height - 1);
+				const std::uint8_t* sourceRow = pixels + static_cast<std::size_t>(sourceY) * width * 4;
+				if (startX + 4 <= width) {
+					std::memcpy(blockPixels + y * 16, sourceRow + startX * 4, 16);
+					continue;
 				}
 
-				texturePosition += blockSize;
+				for (std::int32_t x = 0; x < 4; x++) {
+					std::memcpy(blockPixels + y * 16 + x * 4, sourceRow + std::min(startX + x, width - 1) * 4, 4);
+				}
 			}
+
+			stb_compress_dxt_block(blocks + (blockY * blocksWidth + blockX) * blockSize, blockPixels, hasAlpha, STB_DXT_HIGHQUAL);
 		}
+	});
+}
+
+std::int32_t
+TextureConverter::GetMipLevelsCount(ENFSTextureFormat format, std::int32_t width, std::int32_t height, std::int32_t mipLevels, std::size_t dataSize)
+{
+	const std::int32_t maxLevels = std::min(std::max(1, mipLevels), GetFullMipLevelsCount(width, height));
+	std::int32_t levelsCount = 0;
+	std::size_t chainSize = 0;
+	while (levelsCount < maxLevels) {
+		chainSize += GetMipLevelSize(format, width >> levelsCount, height >> levelsCount);
+		if (chainSize > dataSize) {
+			break;
+		}
+
+		levelsCount++;
 	}
-								   break;
 
-	case ENFSTextureFileFormat::PNG:
-		break;
-	case ENFSTextureFileFormat::JPG:
-		break;
-	default:
+	return std::max(1, levelsCount);
+}
+
+bool
+TextureConverter::GenerateMipChain(std::int32_t width, std::int32_t height, std::int32_t mipLevels, const char* topLevel, std::size_t topLevelSize, std::vector<char>& mipChain)
+{
+	const std::int32_t levelsCount = std::min(std::max(1, mipLevels), GetFullMipLevelsCount(width, height));
+	const std::size_t topSize = GetMipLevelSize(ENFSTextureFormat::RGBA8, width, height);
+	if (width <= 0 || height <= 0 || topLevelSize < topSize) {
+		return false;
+	}
+
+	std::vector<std::size_t> levelOffsets(levelsCount + 1, 0);
+	for (std::int32_t i = 0; i < levelsCount; i++) {
+		levelOffsets[i + 1] = levelOffsets[i] + GetMipLevelSize(ENFSTextureFormat::RGBA8, width >> i, height >> i);
+	}
+
+	mipChain.resize(levelOffsets[levelsCount]);
+	std::memcpy(mipChain.data(), topLevel, topSize);
+
+	// Every level is filtered from the previous one, so the whole chain costs about 1/3 of the top level.
+	// Rows of a level are split into tiles resized in parallel. Tiles are extended by a few rows to
+	// cover the filter support, so the results are the same as for the whole level.
+	constexpr std::int32_t tileRows = 32;
+	constexpr std::int32_t tileMarginRows = 4;
+	std::atomic<bool> bResizeFailed = false;
+	for (std::int32_t i = 1; i < levelsCount; i++) {
+		const std::int32_t srcWidth = std::max(1, width >> (i - 1));
+		const std::int32_t srcHeight = std::max(1, height >> (i - 1));
+		const std::int32_t dstWidth = std::max(1, width >> i);
+		const std::int32_t dstHeight = std::max(1, height >> i);
+		const std::uint8_t* srcPixels = reinterpret_cast<const std::uint8_t*>(mipChain.data() + levelOffsets[i - 1]);
+		std::uint8_t* dstPixels = reinterpret_cast<std::uint8_t*>(mipChain.data() + levelOffsets[i]);
+
+		// Odd heights don't map tile rows to whole source rows
+		const bool canSplit = srcHeight == dstHeight * 2;
+		const std::int32_t tilesCount = canSplit ? (dstHeight + tileRows - 1) / tileRows : 1;
+		ThreadPool::ParallelFor(tilesCount, [&](std::size_t tileIndex) {
+			thread_local std::vector<std::uint8_t> tilePixels;
+			const std::int32_t firstRow = canSplit ? static_cast<std::int32_t>(tileIndex) * tileRows : 0;
+			const std::int32_t rowsCount = canSplit ? std::min(tileRows, dstHeight - firstRow) : dstHeight;
+			const std::int32_t resizeFirstRow = canSplit ? std::max(0, firstRow - tileMarginRows) : 0;
+			const std::int32_t resizeLastRow = canSplit ? std::min(dstHeight, firstRow + rowsCount + tileMarginRows) : dstHeight;
+			const std::int32_t srcFirstRow = canSplit ? resizeFirstRow * 2 : 0;
+			const std::int32_t srcRowsCount = canSplit ? (resizeLastRow - resizeFirstRow) * 2 : srcHeight;
+
+			tilePixels.resize(static_cast<std::size_t>(dstWidth) * (resizeLastRow - resizeFirstRow) * 4);
+			if (!stbir_resize_uint8_srgb_edgemode(
+				srcPixels + static_cast<std::size_t>(srcFirstRow) * srcWidth * 4, srcWidth, srcRowsCount, srcWidth * 4,
+				tilePixels.data(), dstWidth, resizeLastRow - resizeFirstRow, dstWidth * 4,
+				4, 3, 0, STBIR_EDGE_CLAMP
+			)) {
+				bResizeFailed = true;
+				return;
+			}
+
+			std::memcpy(
+				dstPixels + static_cast<std::size_t>(firstRow) * dstWidth * 4,
+				tilePixels.data() + static_cast<std::size_t>(firstRow - resizeFirstRow) * dstWidth * 4,
+				static_cast<std::size_t>(rowsCount) * dstWidth * 4
+			);
+		});
+
+		if (bResizeFailed) {
+			dbg::Warning("Can't resize {}x{} texture to {}x{}.", srcWidth, srcHeight, dstWidth, dstHeight);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool
+TextureConverter::TranscodeTexture(
+	std::int32_t width,
+	std::int32_t height,
+	std::int32_t mipLevels,
+	ENFSTextureFormat format,
+	const char* data,
+	std::size_t dataSize,
+	std::vector<char>& transcodedData,
+	ENFSTextureFormat& outFormat
+)
+{
+	outFormat = GetTranscodedFormat(format);
+	if (outFormat == format) {
+		return false;
+	}
+
+	const std::int32_t levelsCount = GetMipLevelsCount(format, width, height, mipLevels, dataSize);
+	std::size_t transcodedSize = 0;
+	for (std::int32_t i = 0; i < levelsCount; i++) {
+		transcodedSize += GetMipLevelSize(outFormat, width >> i, height >> i);
+	}
+
+	transcodedData.resize(transcodedSize);
+	const char* srcLevel = data;
+	char* dstLevel = transcodedData.data();
+	for (std::int32_t i = 0; i < levelsCount; i++) {
+		const std::int32_t levelWidth = std::max(1, width >> i);
+		const std::int32_t levelHeight = std::max(1, height >> i);
+		const std::size_t blocksWidth = (levelWidth + 3) / 4;
+		const std::size_t blocksHeight = (levelHeight + 3) / 4;
+
+		switch (format) {
+		case ENFSTextureFormat::CTX1:
+			TranscodeCTX1BlocksToBC5(srcLevel, blocksWidth * blocksHeight, dstLevel);
+			break;
+
+		case ENFSTextureFormat::DXT3A: {
+			// Decoding to the block aligned rows, the level is cropped after that
+			std::vector<char> alignedPixels(blocksWidth * 4 * blocksHeight * 4);
+			for (std::size_t y = 0; y < blocksHeight; y++) {
+				DecodeDXT3ABlocksRow(srcLevel + y * blocksWidth * 8, blocksWidth, alignedPixels.data() + y * 4 * blocksWidth * 4, blocksWidth * 4);
+			}
+
+			for (std::int32_t y = 0; y < levelHeight; y++) {
+				std::memcpy(dstLevel + static_cast<std::size_t>(y) * levelWidth, alignedPixels.data() + y * blocksWidth * 4, levelWidth);
+			}
+		}
 		break;
+
+		default:
+			return false;
+		}
+
+		srcLevel += GetMipLevelSize(format, levelWidth, levelHeight);
+		dstLevel += GetMipLevelSize(outFormat, levelWidth, levelHeight);
 	}
 
 	return true;
 }
 
+// Encodes levels starting from firstLevel, the top level is decoded from BC data
+static bool
+EncodeMissingMipLevels(std::int32_t width, std::int32_t height, std::int32_t firstLevel, ENFSTextureFormat format, const char* codedData, std::size_t codedDataSize, std::vector<char>& encodedLevels)
+{
+	std::vector<char> topLevel;
+	ENFSTextureFormat decodedFormat = ENFSTextureFormat::Unknown;
+	if (!TextureConverter::DecodeTexture(width, height, GetTextureBlockSize(format), format, codedData, codedDataSize, topLevel, decodedFormat)) {
+		return false;
+	}
+
+	std::vector<char> mipChain;
+	const std::int32_t levelsCount = GetFullMipLevelsCount(width, height);
+	if (!TextureConverter::GenerateMipChain(width, height, levelsCount, topLevel.data(), topLevel.size(), mipChain)) {
+		return false;
+	}
+
+	std::size_t firstLevelOffset = 0;
+	for (std::int32_t i = 0; i < firstLevel; i++) {
+		firstLevelOffset += GetMipLevelSize(ENFSTextureFormat::RGBA8, width >> i, height >> i);
+	}
+
+	return TextureConverter::EncodeTexture(
+		std::max(1, width >> firstLevel),
+		std::max(1, height >> firstLevel),
+		levelsCount - firstLevel,
+		ENFSTextureFormat::RGBA8,
+		format,
+		mipChain.data() + firstLevelOffset,
+		mipChain.size() - firstLevelOffset,
+		encodedLevels
+	);
+}
+
 bool
 TextureConverter::EncodeTexture(
     std::int32_t width,
@@ -366,14 +1083,58 @@ TextureConverter::EncodeTexture(
                 return false;
             }
             
-            int outLength = 0;
-            std::uint8_t* pngData = stbi_write_png_to_mem((std::uint8_t*)rawData, width * 4, width, height, 4, &outLength);
-            if (pngData == nullptr) {
+            if (rawDataSize < GetMipLevelSize(srcFormat, width, height)) {
+                dbg::Warning("Not enough data to encode {}x{} texture to png ({} bytes).", width, height, rawDataSize);
                 return false;
             }
-            
-            encodedData.resize(outLength);
-            std::memcpy(encodedData.data(), pngData, outLength);
+
+            encodedData.clear();
+            const int result = stbi_write_png_to_func([](void* context, void* data, int size) {
+                std::vector<char>* outData = static_cast<std::vector<char>*>(context);
+                outData->insert(outData->end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+            }, &encodedData, width, height, 4, rawData, width * 4);
+
+            if (result == 0) {
+                return false;
+            }
+        }
+        break;
+
+        case ENFSTextureFormat::BC1:
+        case ENFSTextureFormat::BC3: {
+            if (srcFormat != ENFSTextureFormat::RGBA8) {
+                dbg::Warning("Can't encode texture to BC format because it's not in RGBA8 format...");
+                return false;
+            }
+
+            const std::int32_t levelsCount = std::max(1, mipLevels);
+            std::size_t rawChainSize = 0;
+            std::size_t encodedChainSize = 0;
+            for (std::int32_t i = 0; i < levelsCount; i++) {
+                rawChainSize += GetMipLevelSize(srcFormat, width >> i, height >> i);
+                encodedChainSize += GetMipLevelSize(dstFormat, width >> i, height >> i);
+            }
+
+            if (rawDataSize < rawChainSize) {
+                dbg::Warning("Not enough data to encode {}x{} texture with {} mip levels ({} bytes).", width, height, levelsCount, rawDataSize);
+                return false;
+            }
+
+            // Older stb_dxt versions initialize their tables on the first call, so it must be done before going parallel
+            std::uint8_t warmupPixels[4 * 4 * 4] = {};
+            std::uint8_t warmupBlock[16] = {};
+            stb_compress_dxt_block(warmupBlock, warmupPixels, 0, STB_DXT_NORMAL);
+
+            encodedData.resize(encodedChainSize);
+            const std::uint8_t* levelPixels = reinterpret_cast<const std::uint8_t*>(rawData);
+            std::uint8_t* levelBlocks = reinterpret_cast<std::uint8_t*>(encodedData.data());
+            for (std::int32_t i = 0; i < levelsCount; i++) {
+                const std::int32_t levelWidth = std::max(1, width >> i);
+                const std::int32_t levelHeight = std::max(1, height >> i);
+                EncodeBCLevel(dstFormat, levelWidth, levelHeight, levelPixels, levelBlocks);
+                levelPixels += GetMipLevelSize(srcFormat, levelWidth, levelHeight);
+                levelBlocks += GetMipLevelSize(dstFormat, levelWidth, levelHeight);
+            }
         }
         break;
             
@@ -392,12 +1153,22 @@ DDS_HEADER MakeDDSHeader(ENFSTextureFormat format, std::int32_t width, std::int3
     ddsHeader.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
     ddsHeader.dwHeight = height;
     ddsHeader.dwWidth = width;
-    ddsHeader.dwPitchOrLinearSize = std::max((std::uint32_t)1, (ddsHeader.dwWidth + 3) / 4) * std::max((std::uint32_t)1, (ddsHeader.dwHeight + 3) / 4) * 8;
+    ddsHeader.dwPitchOrLinearSize = static_cast<std::uint32_t>(GetMipLevelSize(format, width, height));
     ddsHeader.dwMipMapCount = mipMapLevels;
     ddsHeader.dwCaps = DDSCAPS_TEXTURE;
+    if (mipMapLevels > 1) {
+        ddsHeader.dwCaps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
 
     ddsHeader.ddspf.dwSize = 32;
-    ddsHeader.ddspf.dwFlags = 0x4;
+    ddsHeader.ddspf.dwFlags = DDPF_FOURCC;
+
+    // Uncompressed formats are described by the pitch and channel masks
+    if (GetTextureBlockDimension(format) == 1) {
+        ddsHeader.dwFlags = (ddsHeader.dwFlags & ~DDSD_LINEARSIZE) | DDSD_PITCH;
+        ddsHeader.dwPitchOrLinearSize = static_cast<std::uint32_t>(std::max(1, width)) * GetTextureBlockSize(format);
+        ddsHeader.ddspf.dwRGBBitCount = GetTextureBlockSize(format) * 8;
+    }
 
     switch (format) {
     case ENFSTextureFormat::BC1:
@@ -409,6 +1180,35 @@ DDS_HEADER MakeDDSHeader(ENFSTextureFormat format, std::int32_t width, std::int3
     case ENFSTextureFormat::BC3:
         ddsHeader.ddspf.dwFourCC = FOURCC_DXT5;
         break;
+    case ENFSTextureFormat::BC4:
+        ddsHeader.ddspf.dwFourCC = FOURCC_ATI1;
+        break;
+    case ENFSTextureFormat::BC5:
+        ddsHeader.ddspf.dwFourCC = FOURCC_ATI2;
+        break;
+    case ENFSTextureFormat::BGRA8:
+        ddsHeader.ddspf.dwFlags = DDPF_RGB | DDPF_ALPHAPIXELS;
+        ddsHeader.ddspf.dwRBitMask = 0x00FF0000;
+        ddsHeader.ddspf.dwGBitMask = 0x0000FF00;
+        ddsHeader.ddspf.dwBBitMask = 0x000000FF;
+        ddsHeader.ddspf.dwABitMask = 0xFF000000;
+        break;
+    case ENFSTextureFormat::RGBA8:
+        ddsHeader.ddspf.dwFlags = DDPF_RGB | DDPF_ALPHAPIXELS;
+        ddsHeader.ddspf.dwRBitMask = 0x000000FF;
+        ddsHeader.ddspf.dwGBitMask = 0x0000FF00;
+        ddsHeader.ddspf.dwBBitMask = 0x00FF0000;
+        ddsHeader.ddspf.dwABitMask = 0xFF000000;
+        break;
+    case ENFSTextureFormat::RG8:
+        ddsHeader.ddspf.dwFlags = DDPF_RGB;
+        ddsHeader.ddspf.dwRBitMask = 0x000000FF;
+        ddsHeader.ddspf.dwGBitMask = 0x0000FF00;
+        break;
+    case ENFSTextureFormat::R8:
+        ddsHeader.ddspf.dwFlags = DDPF_LUMINANCE;
+        ddsHeader.ddspf.dwRBitMask = 0x000000FF;
+        break;
     default:
         break;
     }
@@ -416,6 +1216,19 @@ DDS_HEADER MakeDDSHeader(ENFSTextureFormat format, std::int32_t width, std::int3
     return ddsHeader;
 }
 
+bool
+TextureConverter::WriteDDSData(nfr::api::IStream* encodedFile, const void* data, std::size_t dataSize)
+{
+    return encodedFile->write(const_cast<void*>(data), static_cast<std::int64_t>(dataSize)) == static_cast<std::int64_t>(dataSize);
+}
+
+bool
+TextureConverter::WriteDDSHeader(nfr::api::IStream* encodedFile, ENFSTextureFormat format, std::int32_t width, std::int32_t height, std::int32_t mipMapLevels)
+{
+    const DDS_HEADER ddsHeader = MakeDDSHeader(format, width, height, mipMapLevels);
+    return WriteDDSData(encodedFile, "DDS ", 4) && WriteDDSData(encodedFile, &ddsHeader, sizeof(DDS_HEADER));
+}
+
 bool TextureConverter::EncodeTextureToFile(
     std::int32_t width,
     std::int32_t height,
@@ -431,11 +1244,40 @@ bool TextureConverter::EncodeTextureToFile(
         switch (srcFormat) {
             case ENFSTextureFormat::BC1:
             case ENFSTextureFormat::BC2:
-            case ENFSTextureFormat::BC3: {
-                encodedFile->write((void*)"DDS ", 4);
-                DDS_HEADER ddsHeader = MakeDDSHeader(dstFormat, width, height, mipLevels);
-                encodedFile->write(&ddsHeader, sizeof(DDS_HEADER));
-                encodedFile->write((void*)rawData, rawDataSize);
+            case ENFSTextureFormat::BC3:
+            case ENFSTextureFormat::BC4:
+            case ENFSTextureFormat::BC5:
+            case ENFSTextureFormat::BGRA8:
+            case ENFSTextureFormat::RGBA8:
+            case ENFSTextureFormat::RG8:
+            case ENFSTextureFormat::R8: {
+                // Existing levels are written as is, only the missing BC1/BC3 ones are encoded (stb_dxt can't encode others)
+                std::int32_t levelsCount = std::max(1, mipLevels);
+                std::size_t levelsSize = rawDataSize;
+                std::vector<char> missingLevels;
+                const bool canEncode = srcFormat == ENFSTextureFormat::BC1 || srcFormat == ENFSTextureFormat::BC3;
+                if (GenerateMissingMipLevels && canEncode && levelsCount < GetFullMipLevelsCount(width, height)) {
+                    std::size_t existingSize = 0;
+                    for (std::int32_t i = 0; i < levelsCount; i++) {
+                        existingSize += GetMipLevelSize(srcFormat, width >> i, height >> i);
+                    }
+
+                    if (existingSize <= rawDataSize && EncodeMissingMipLevels(width, height, levelsCount, srcFormat, rawData, rawDataSize, missingLevels)) {
+                        levelsCount = GetFullMipLevelsCount(width, height);
+                        levelsSize = existingSize;
+                    } else {
+                        dbg::Warning("Can't generate mip levels for {}x{} texture.", width, height);
+                        missingLevels.clear();
+                    }
+                }
+
+                if (!WriteDDSHeader(encodedFile, dstFormat, width, height, levelsCount) || !WriteDDSData(encodedFile, rawData, levelsSize)) {
+                    return false;
+                }
+
+                if (!missingLevels.empty() && !WriteDDSData(encodedFile, missingLevels.data(), missingLevels.size())) {
+                    return false;
+                }
             }
             break;
                 
@@ -445,6 +1287,7 @@ bool TextureConverter::EncodeTextureToFile(
     } else {
         const char* dataPtr = rawData;
         std::size_t dataPtrSize = rawDataSize;
+        std::int32_t dataMipLevels = mipLevels;
         std::vector<char> decodedData;
         
         if (srcFormat != ENFSTextureFormat::RGBA8) {
@@ -460,18 +1303,143 @@ bool TextureConverter::EncodeTextureToFile(
                 return false;
             }
             
+            // Only the top level is decoded
             dataPtr = decodedData.data();
             dataPtrSize = decodedData.size();
+            dataMipLevels = 1;
         }
         
+        if (dstFormat == ENFSTextureFormat::PNG) {
+            return WritePNG(width, height, dataPtr, dataPtrSize, encodedFile);
+        }
+
+        std::vector<char> mipChain;
+        const bool isBlockFormat = dstFormat == ENFSTextureFormat::BC1 || dstFormat == ENFSTextureFormat::BC3;
+        if (GenerateMissingMipLevels && isBlockFormat && dataMipLevels < GetFullMipLevelsCount(width, height)) {
+            dataMipLevels = GetFullMipLevelsCount(width, height);
+            if (!GenerateMipChain(width, height, dataMipLevels, dataPtr, dataPtrSize, mipChain)) {
+                return false;
+            }
+
+            dataPtr = mipChain.data();
+            dataPtrSize = mipChain.size();
+        }
+
         std::vector<char> encodedData;
-        if (!EncodeTexture(width, height, mipLevels, srcFormat, dstFormat, dataPtr, dataPtrSize, encodedData)) {
+        if (!EncodeTexture(width, height, dataMipLevels, srcFormat, dstFormat, dataPtr, dataPtrSize, encodedData)) {
             dbg::Error("Can't encode from {} to {} format.", (std::uint32_t)srcFormat, (std::uint32_t)dstFormat);
             return false;
         }
+
+        switch (dstFormat) {
+            case ENFSTextureFormat::BC1:
+            case ENFSTextureFormat::BC3: {
+                if (!WriteDDSHeader(encodedFile, dstFormat, width, height, std::max(1, dataMipLevels)) || !WriteDDSData(encodedFile, encodedData.data(), encodedData.size())) {
+                    return false;
+                }
+            }
+            break;
+
+            default:
+                break;
+        }
     }
     
 	return true;
 }
 
+void
+TextureConverter::SetPNGCompression(EPNGCompression compression)
+{
+	stbi_write_png_compression_level = static_cast<int>(compression);
+
+	// stb tries every filter on each row by default, which costs more than the deflate itself at low levels
+	stbi_write_force_png_filter = compression == EPNGCompression::Fast ? 1 : -1;
+}
+
+struct PNGWriteContext
+{
+	nfr::api::IStream* File;
+	bool Failed;
+};
+
+bool
+TextureConverter::WritePNG(std::int32_t width, std::int32_t height, const char* rawData, std::size_t rawDataSize, nfr::api::IStream* pngFile)
+{
+	if (width <= 0 || height <= 0 || rawDataSize < GetMipLevelSize(ENFSTextureFormat::RGBA8, width, height)) {
+		dbg::Warning("Not enough data to write {}x{} texture to png ({} bytes).", width, height, rawDataSize);
+		return false;
+	}
+
+	// stb writes the whole file in a few calls, so there is nothing to buffer here
+	PNGWriteContext writeContext = { pngFile, false };
+	const int result = stbi_write_png_to_func([](void* context, void* data, int size) {
+		PNGWriteContext* writeContext = static_cast<PNGWriteContext*>(context);
+		if (!writeContext->Failed && writeContext->File->write(data, size) != size) {
+			writeContext->Failed = true;
+		}
+	}, &writeContext, width, height, 4, rawData, width * 4);
+
+	return result != 0 && !writeContext.Failed;
+}
+
+// Textures are converted on pool threads, but the engine factory isn't guaranteed to be thread-safe
+static std::mutex OutputFilesLock;
+
+bool
+TextureConverter::OutputFileExists(const nfr::api::path& filePath)
+{
+	std::lock_guard<std::mutex> lock(OutputFilesLock);
+	return EngineFactory->exists(filePath);
+}
+
+nfr::api::SafeInterface<nfr::api::IStream>
+TextureConverter::CreateOutputFile(const nfr::api::path& filePath)
+{
+	std::lock_guard<std::mutex> lock(OutputFilesLock);
+	if (EngineFactory->exists(filePath)) {
+		std::filesystem::remove(filePath);
+	}
+
+	return EngineFactory->openFile(nfr::api::EStreamFlags::WriteFlag, filePath);
+}
+
+bool
+TextureConverter::ExportPNGBatch(const std::vector<PNGExportTask>& exportTasks)
+{
+	std::atomic<bool> bExportFailed = false;
+	ThreadPool::ParallelFor(exportTasks.size(), [&](std::size_t i) {
+		thread_local std::vector<char> decodedData;
+		const PNGExportTask& exportTask = exportTasks[i];
+
+		const char* rgbaData = exportTask.Data;
+		std::size_t rgbaDataSize = exportTask.DataSize;
+		if (exportTask.Format != ENFSTextureFormat::RGBA8) {
+			ENFSTextureFormat decodedFormat = ENFSTextureFormat::Unknown;
+			if (!DecodeTexture(exportTask.Width, exportTask.Height, GetTextureBlockSize(exportTask.Format), exportTask.Format, exportTask.Data, exportTask.DataSize, decodedData, decodedFormat)) {
+				bExportFailed = true;
+				return;
+			}
+
+			// Formats which can't be decoded leave the buffer of the previous task
+			if (decodedFormat != ENFSTextureFormat::RGBA8) {
+				dbg::Warning("Can't export {} texture to png file \"{}\".", GetNFSFormatString(exportTask.Format), exportTask.OutputPath.generic_string());
+				bExportFailed = true;
+				return;
+			}
+
+			rgbaData = decodedData.data();
+			rgbaDataSize = decodedData.size();
+		}
+
+		nfr::api::SafeInterface<nfr::api::IStream> pngFile = CreateOutputFile(exportTask.OutputPath);
+		if (!pngFile->isOpen() || !WritePNG(exportTask.Width, exportTask.Height, rgbaData, rgbaDataSize, pngFile.get())) {
+			dbg::Warning("Can't write png file \"{}\".", exportTask.OutputPath.generic_string());
+			bExportFailed = true;
+		}
+	});
+
+	return !bExportFailed;
+}
+
 }
@@ -40,10 +40,18 @@
 #define DDSD_SRCVBHANDLE        0x00400000l
 #define DDSD_DEPTH              0x00800000l
 #define DDSD_ALL                0x00fff9eel
+#define DDSCAPS_COMPLEX			0x00000008l
 #define DDSCAPS_TEXTURE			0x00001000l
+#define DDSCAPS_MIPMAP			0x00400000l
 #define FOURCC_DXT1				0x31545844
 #define FOURCC_DXT3				0x33545844
 #define FOURCC_DXT5				0x35545844
+#define FOURCC_ATI1				0x31495441
+#define FOURCC_ATI2				0x32495441
+#define DDPF_ALPHAPIXELS		0x00000001l
+#define DDPF_FOURCC				0x00000004l
+#define DDPF_RGB				0x00000040l
+#define DDPF_LUMINANCE			0x00020000l
 
 struct DDS_PIXELFORMAT 
 {
@@ -95,7 +103,15 @@ enum class ENFSTextureFormat : std::uint32_t
 	RG8,
 	R8,
 
-	PNG
+	PNG,
+
+	BC4,
+	BC5,
+	BGRA8,
+
+	// Xenon only formats, transcoded on load (see GetTranscodedFormat)
+	DXT3A,
+	CTX1
 };
 
 inline const char* GetNFSFormatString(ENFSTextureFormat format)
@@ -107,6 +123,24 @@ inline const char* GetNFSFormatString(ENFSTextureFormat format)
 		return "BC2";
 	case ENFSTextureFormat::BC3:
 		return "BC3";
+	case ENFSTextureFormat::BC4:
+		return "BC4";
+	case ENFSTextureFormat::BC5:
+		return "BC5";
+	case ENFSTextureFormat::F16:
+		return "F16";
+	case ENFSTextureFormat::RGBA8:
+		return "RGBA8";
+	case ENFSTextureFormat::BGRA8:
+		return "BGRA8";
+	case ENFSTextureFormat::RG8:
+		return "RG8";
+	case ENFSTextureFormat::R8:
+		return "R8";
+	case ENFSTextureFormat::DXT3A:
+		return "DXT3A";
+	case ENFSTextureFormat::CTX1:
+		return "CTX1";
     default:
         break;
 	}
@@ -117,6 +151,10 @@ inline const char* GetNFSFormatString(ENFSTextureFormat format)
 inline ENFSTextureFormat GetNFSFormatFromCompressionType(char compressionType)
 {
 	switch (compressionType) {
+	case 32:
+		return ENFSTextureFormat::BGRA8;
+	case 34:
+		return ENFSTextureFormat::BC1;
 	case 36:
 		return ENFSTextureFormat::BC2;
 	case 38:
@@ -137,6 +175,21 @@ inline ENFSTextureFormat GetNFSFormatFromFCC(std::uint32_t fourCC)
 		return ENFSTextureFormat::BC2;
 	case 0x1A200154:
 		return ENFSTextureFormat::BC3;
+	case 0x1A200171:	// D3DFMT_DXN
+		return ENFSTextureFormat::BC5;
+	case 0x1A20017B:	// D3DFMT_DXT5A
+		return ENFSTextureFormat::BC4;
+	case 0x1A20017A:	// D3DFMT_DXT3A
+		return ENFSTextureFormat::DXT3A;
+	case 0x1A20017C:	// D3DFMT_CTX1
+		return ENFSTextureFormat::CTX1;
+	case 0x18280186:	// D3DFMT_A8R8G8B8
+	case 0x28280186:	// D3DFMT_X8R8G8B8
+		return ENFSTextureFormat::BGRA8;
+	case 0x28000102:	// D3DFMT_L8
+		return ENFSTextureFormat::R8;
+	case 0x2D20014A:	// D3DFMT_G8R8
+		return ENFSTextureFormat::RG8;
 	default:
 		break;
 	}
@@ -144,9 +197,31 @@ inline ENFSTextureFormat GetNFSFormatFromFCC(std::uint32_t fourCC)
 	return ENFSTextureFormat::Unknown;
 }
 
+// Formats without PC equivalent are converted to the closest one: CTX1 is transcoded
+// to BC5 block by block and 4-bit DXT3A is expanded to R8.
+inline ENFSTextureFormat GetTranscodedFormat(ENFSTextureFormat format)
+{
+	switch (format) {
+	case ENFSTextureFormat::DXT3A:
+		return ENFSTextureFormat::R8;
+	case ENFSTextureFormat::CTX1:
+		return ENFSTextureFormat::BC5;
+	default:
+		break;
+	}
+
+	return format;
+}
+
 namespace bb
 {
 
+// Bytes per 4x4 block for block compressed formats, bytes per pixel for others
+std::uint32_t GetTextureBlockSize(ENFSTextureFormat textureFormat);
+
+// Size of the block side in pixels (1 for uncompressed formats)
+std::int32_t GetTextureBlockDimension(ENFSTextureFormat textureFormat);
+
 struct TextureInformation
 {
 	ENFSTextureFormat Format;
@@ -156,10 +231,92 @@ struct TextureInformation
 	std::int16_t Alignment;
 };
 
+struct TextureLevelView
+{
+	std::int32_t Width;
+	std::int32_t Height;
+	const char* Data;
+	std::size_t Size;
+};
+
+// Mip levels of the texture point directly to the file data
+struct DDSTextureView
+{
+	TextureInformation Information;
+	std::vector<TextureLevelView> Levels;
+};
+
+std::uint64_t CalculateTextureSize(ENFSTextureFormat format, std::uint32_t width, std::uint32_t height, std::uint32_t mipLevels);
+
+struct XenonUntileLevel
+{
+	std::int32_t Width;
+	std::int32_t Height;
+	std::size_t LinearOffset;
+	std::size_t LinearSize;
+	std::size_t TiledEnd;
+	std::size_t FirstBlock;
+	std::size_t FirstSpan;
+	std::size_t SpansCount;		// 0 if level can't be copied by 16 bytes spans
+};
+
+// Source offset of every block of the linear mip chain inside Xenon tiled data. Neighbour blocks
+// of micro tile rows are also merged into 16 bytes spans which can be moved by vector registers.
+struct XenonUntileTable
+{
+	std::vector<XenonUntileLevel> Levels;
+	std::vector<std::uint32_t> SourceOffsets;
+	std::vector<std::uint32_t> SpanOffsets;
+};
+
+// Missing mip levels of BC1/BC3 textures are generated when textures are written to DDS
+extern bool GenerateMissingMipLevels;
+
+// zlib compression level of stb PNG writer
+enum class EPNGCompression : std::int32_t
+{
+	Fast = 1,		// previews, the per-row filter search is skipped too
+	Default = 8
+};
+
+struct PNGExportTask
+{
+	std::int32_t Width;
+	std::int32_t Height;
+	ENFSTextureFormat Format;	// only the top level is exported
+	const char* Data;
+	std::size_t DataSize;
+	nfr::api::path OutputPath;
+};
+
 class TextureConverter
 {
 public:
-	static bool UntileXenonTexture(std::int32_t width, std::int32_t height, std::int32_t mipLevels, std::int32_t blockSize, const char* xenonData, char* pcData);
+	// Count of complete mip levels in dataSize bytes (never more than mipLevels or the full chain)
+	static std::int32_t GetMipLevelsCount(ENFSTextureFormat format, std::int32_t width, std::int32_t height, std::int32_t mipLevels, std::size_t dataSize);
+
+	// Builds RGBA8 mip chain of mipLevels levels from the RGBA8 top level with gamma correct filtering
+	static bool GenerateMipChain(std::int32_t width, std::int32_t height, std::int32_t mipLevels, const char* topLevel, std::size_t topLevelSize, std::vector<char>& mipChain);
+
+	// Tables are built once per texture dimensions and shared between all textures of the same size
+	static std::shared_ptr<const XenonUntileTable> GetXenonUntileTable(std::int32_t width, std::int32_t height, std::int32_t mipLevels, std::int32_t blockSize, std::int32_t blockDimension);
+
+	// blockDimension - 4 for block compressed formats, 1 for uncompressed ones (blockSize is the size of one pixel then)
+	// swapBytes - swap 16-bit words of big endian data while untiling, 32-bit pixels are swapped as a whole (xenonData is never modified)
+	// outMipLevels - count of untiled mip levels (levels which aren't present in xenonData are dropped)
+	static bool UntileXenonTexture(std::int32_t width, std::int32_t height, std::int32_t mipLevels, std::int32_t blockSize, std::int32_t blockDimension, const char* xenonData, std::size_t xenonDataSize, bool swapBytes, std::vector<char>& pcData, std::int32_t& outMipLevels);
+
+	// Converts the whole mip chain of Xenon only format to GetTranscodedFormat(format)
+	static bool TranscodeTexture(std::int32_t width, std::int32_t height, std::int32_t mipLevels, ENFSTextureFormat format, const char* data, std::size_t dataSize, std::vector<char>& transcodedData, ENFSTextureFormat& outFormat);
+
+	// Validates DDS header and splits data to mip levels without copying (levels which aren't present in the file are dropped)
+	static bool ParseDDSTexture(const char* fileData, std::size_t fileSize, DDSTextureView& outView);
+
+	// The file is mapped to memory, level views are valid while mappedFile is open
+	static bool MapDDSFile(const nfr::api::path& filePath, MappedFile& mappedFile, DDSTextureView& outView);
+
+	// Decodes only the requested level to RGBA8
+	static bool DecodeTextureLevel(const DDSTextureView& textureView, std::int32_t level, std::vector<char>& rawData);
 
 	// rawData - directly loaded texture from DDS file (without decoding)
 	static bool LoadTextureFromDDSFile(nfr::api::IStream* file, std::vector<char>& rawData, TextureInformation& outInformation);
@@ -169,8 +326,27 @@ public:
 
 	static bool DecodeTexture(std::int32_t width, std::int32_t height, std::int32_t blockSize, ENFSTextureFormat formatToDecode, const char* codedData, std::size_t codedDataSize, std::vector<char>& rawData, ENFSTextureFormat& outFormat);
 
+	// BC1 and BC3 are encoded from RGBA8 mip chain (rawData must contain all mipLevels levels)
 	static bool EncodeTexture(std::int32_t width, std::int32_t height, std::int32_t mipLevels, ENFSTextureFormat srcFormat, ENFSTextureFormat dstFormat, const char* rawData, std::size_t rawDataSize, std::vector<char>& encodedData);
 	static bool EncodeTextureToFile(std::int32_t width, std::int32_t height, std::int32_t mipLevels, ENFSTextureFormat srcFormat, ENFSTextureFormat dstFormat, const char* rawData, std::size_t rawDataSize, nfr::api::IStream* encodedFile);
+
+	// Short writes leave a broken file, so the caller must fail the texture if these return false
+	static bool WriteDDSHeader(nfr::api::IStream* encodedFile, ENFSTextureFormat format, std::int32_t width, std::int32_t height, std::int32_t mipMapLevels);
+	static bool WriteDDSData(nfr::api::IStream* encodedFile, const void* data, std::size_t dataSize);
+
+	// Output files are created from pool threads, all of them go through these two to stay under one lock.
+	// An existing file is removed first, so a shorter output never leaves the tail of the old one.
+	static bool OutputFileExists(const nfr::api::path& filePath);
+	static nfr::api::SafeInterface<nfr::api::IStream> CreateOutputFile(const nfr::api::path& filePath);
+
+	// Compression level is global for stb, so it must be set before any conversion starts
+	static void SetPNGCompression(EPNGCompression compression);
+
+	// Encodes RGBA8 image straight to the file without intermediate buffers
+	static bool WritePNG(std::int32_t width, std::int32_t height, const char* rawData, std::size_t rawDataSize, nfr::api::IStream* pngFile);
+
+	// Exports textures in parallel (e.g. previews of the whole pack). Returns false if any of them failed.
+	static bool ExportPNGBatch(const std::vector<PNGExportTask>& exportTasks);
 };
 
 }
@@ -0,0 +1,180 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace bb
+{
+
+struct ParallelJob
+{
+	const std::function<void(std::size_t)>* Function = nullptr;
+	std::size_t Count = 0;
+	std::atomic<std::size_t> NextIndex = 0;
+	std::atomic<std::size_t> DoneCount = 0;
+	std::mutex DoneLock;
+	std::condition_variable DoneEvent;
+};
+
+static std::mutex PoolLock;
+static std::condition_variable PoolWakeup;
+static std::deque<std::shared_ptr<ParallelJob>> PendingJobs;
+static std::vector<std::thread> Workers;
+static std::atomic<bool> bPoolRunning = false;
+static bool bPoolStopping = false;
+
+static void
+RunJobItems(ParallelJob& job)
+{
+	std::size_t executedCount = 0;
+	for (;;) {
+		const std::size_t index = job.NextIndex.fetch_add(1);
+		if (index >= job.Count) {
+			break;
+		}
+
+		(*job.Function)(index);
+		executedCount++;
+	}
+
+	if (executedCount != 0 && job.DoneCount.fetch_add(executedCount) + executedCount == job.Count) {
+		std::lock_guard<std::mutex> lock(job.DoneLock);
+		job.DoneEvent.notify_all();
+	}
+}
+
+static void
+RemoveJob(const std::shared_ptr<ParallelJob>& job)
+{
+	std::lock_guard<std::mutex> lock(PoolLock);
+	auto it = std::find(PendingJobs.begin(), PendingJobs.end(), job);
+	if (it != PendingJobs.end()) {
+		PendingJobs.erase(it);
+	}
+}
+
+static void
+WorkerLoop()
+{
+	for (;;) {
+		std::shared_ptr<ParallelJob> job;
+		{
+			std::unique_lock<std::mutex> lock(PoolLock);
+			PoolWakeup.wait(lock, []() { return bPoolStopping || !PendingJobs.empty(); });
+			if (PendingJobs.empty()) {
+				return;
+			}
+
+			job = PendingJobs.front();
+		}
+
+		RunJobItems(*job);
+		RemoveJob(job);
+	}
+}
+
+void
+ThreadPool::Start(std::size_t workersCount)
+{
+	if (bPoolRunning) {
+		return;
+	}
+
+	if (workersCount == 0) {
+		const std::size_t hardwareThreads = std::thread::hardware_concurrency();
+		workersCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	bPoolStopping = false;
+	Workers.reserve(workersCount);
+	for (std::size_t i = 0; i < workersCount; i++) {
+		Workers.emplace_back(WorkerLoop);
+	}
+
+	bPoolRunning = true;
+	dbg::Verbose("Thread pool started with {} workers", workersCount);
+}
+
+void
+ThreadPool::Stop()
+{
+	if (!bPoolRunning) {
+		return;
+	}
+
+	bPoolRunning = false;
+	{
+		std::lock_guard<std::mutex> lock(PoolLock);
+		bPoolStopping = true;
+	}
+
+	PoolWakeup.notify_all();
+	for (std::thread& worker : Workers) {
+		worker.join();
+	}
+
+	Workers.clear();
+}
+
+bool
+ThreadPool::IsRunning()
+{
+	return bPoolRunning;
+}
+
+std::size_t
+ThreadPool::GetWorkersCount()
+{
+	return bPoolRunning ? Workers.size() : 0;
+}
+
+void
+ThreadPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)>& function)
+{
+	if (!bPoolRunning || count <= 1) {
+		for (std::size_t i = 0; i < count; i++) {
+			function(i);
+		}
+
+		return;
+	}
+
+	std::shared_ptr<ParallelJob> job = std::make_shared<ParallelJob>();
+	job->Function = &function;
+	job->Count = count;
+	{
+		std::lock_guard<std::mutex> lock(PoolLock);
+		PendingJobs.push_back(job);
+	}
+
+	PoolWakeup.notify_all();
+	RunJobItems(*job);
+	{
+		std::unique_lock<std::mutex> lock(job->DoneLock);
+		job->DoneEvent.wait(lock, [&job]() { return job->DoneCount.load() == job->Count; });
+	}
+
+	RemoveJob(job);
+}
+
+}
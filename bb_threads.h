@@ -0,0 +1,57 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+#include <functional>
+
+namespace bb
+{
+
+// Pool of worker threads for data parallel loops. The thread which calls ParallelFor
+// takes part in the work too, so nested loops can't lock the pool.
+class ThreadPool
+{
+public:
+	// workersCount - 0 to use all hardware threads
+	static void Start(std::size_t workersCount = 0);
+	static void Stop();
+
+	static bool IsRunning();
+	static std::size_t GetWorkersCount();
+
+	// Calls function for every index in [0, count) and waits for all of them.
+	// Runs on the calling thread only if the pool isn't started.
+	static void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& function);
+};
+
+class ThreadPoolScope
+{
+public:
+	ThreadPoolScope()
+	{
+		ThreadPool::Start();
+	}
+
+	~ThreadPoolScope()
+	{
+		ThreadPool::Stop();
+	}
+};
+
+}
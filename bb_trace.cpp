@@ -0,0 +1,266 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#include "blackbox_pch.h"
+#include <thread>
+
+namespace bb
+{
+
+// Bounded multi-producer queue (D. Vyukov), every cell has a sequence number which tells
+// whether the cell is free for the writer or ready for the reader.
+struct TraceCell
+{
+	std::atomic<std::size_t> Sequence;
+	TraceRecord Record;
+};
+
+constexpr std::size_t TraceBufferSize = 1 << 16;
+
+static std::unique_ptr<TraceCell[]> TraceBuffer;
+static std::atomic<std::size_t> WritePosition;
+static std::size_t ReadPosition;
+static std::atomic<std::uint64_t> DroppedRecords;
+static std::atomic_bool TraceRunning;
+static std::atomic_bool TraceStopRequested;
+static std::atomic<std::uint32_t> ActiveWriters;
+static std::thread TraceThread;
+
+static std::string
+GetEntryName(std::uint32_t nameHash)
+{
+	auto entryIt = EntriesMap.find(nameHash);
+	return entryIt != EntriesMap.end() ? entryIt->second : std::to_string(nameHash);
+}
+
+static std::string
+GetRecordName(const TraceRecord& record)
+{
+	std::unique_ptr<std::string> name(record.Message);
+	return name != nullptr ? std::move(*name) : GetEntryName(record.Args[0]);
+}
+
+static void
+WriteMessage(spdlog::level::level_enum level, const std::string& message)
+{
+	switch (level) {
+	case spdlog::level::trace:
+		GameLogger->trace("{}", message);
+		break;
+	case spdlog::level::info:
+		GameLogger->info("{}", message);
+		break;
+	case spdlog::level::warn:
+		GameLogger->warn("{}", message);
+		break;
+	default:
+		GameLogger->error("{}", message);
+		break;
+	}
+}
+
+// Called on the trace thread only, so it writes to the logger directly
+static void
+FormatRecord(const TraceRecord& record)
+{
+	const std::uint32_t* args = record.Args;
+	switch (record.Event) {
+	case ETraceEvent::Message: {
+		std::unique_ptr<std::string> message(record.Message);
+		WriteMessage(static_cast<spdlog::level::level_enum>(args[0]), *message);
+	}
+	break;
+	case ETraceEvent::FileEntry:
+		GameLogger->trace("        entry {}: crc32: {:#06x}; hash: {:#06x} ", GetEntryName(args[0]), args[1], args[0]);
+		break;
+	case ETraceEvent::ChunkBegin:
+		GameLogger->trace("");
+		GameLogger->trace("[\"{}\"]:", GetNFSChunkName(args[0]));
+		GameLogger->trace("--------------------------------------------------");
+		break;
+	case ETraceEvent::TexturePackEntry:
+		GameLogger->trace("        Found entry hash {:#06x} (padding: {})", args[0], args[1]);
+		break;
+	case ETraceEvent::TextureStreamEntry:
+		GameLogger->trace("        Found streaming entry {:#06x}", args[0]);
+		break;
+	case ETraceEvent::TextureInfoEntry:
+		GameLogger->trace("        Found texture info {:#06x} ({})", args[0], GetRecordName(record));
+		break;
+	case ETraceEvent::TextureLoad:
+		GameLogger->trace("        Loading {} ({}x{}, {}KB, {} mips, {} format)... ",
+			GetRecordName(record),
+			args[1],
+			args[2],
+			args[3] / 1024,
+			args[4],
+			GetNFSFormatString(static_cast<ENFSTextureFormat>(args[5]))
+		);
+		break;
+	default:
+		break;
+	}
+}
+
+static bool
+ReadRecord(TraceRecord& outRecord)
+{
+	TraceCell& cell = TraceBuffer[ReadPosition & (TraceBufferSize - 1)];
+	if (cell.Sequence.load(std::memory_order_acquire) != ReadPosition + 1) {
+		return false;
+	}
+
+	outRecord = cell.Record;
+	cell.Sequence.store(ReadPosition + TraceBufferSize, std::memory_order_release);
+	ReadPosition++;
+	return true;
+}
+
+static void
+TraceThreadProc()
+{
+	TraceRecord record = {};
+	while (true) {
+		const bool stopRequested = TraceStopRequested.load(std::memory_order_acquire);
+		bool recordsReaded = false;
+		while (ReadRecord(record)) {
+			FormatRecord(record);
+			recordsReaded = true;
+		}
+
+		if (stopRequested) {
+			break;
+		}
+
+		if (!recordsReaded) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+void
+TraceLog::Start()
+{
+	if constexpr (dbg::TraceEnabled) {
+		if (TraceRunning || !dbg::IsVerboseEnabled()) {
+			return;
+		}
+
+		if (TraceBuffer == nullptr) {
+			TraceBuffer = std::make_unique<TraceCell[]>(TraceBufferSize);
+		}
+
+		for (std::size_t i = 0; i < TraceBufferSize; i++) {
+			TraceBuffer[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+
+		WritePosition.store(0, std::memory_order_relaxed);
+		ReadPosition = 0;
+		DroppedRecords = 0;
+		TraceStopRequested = false;
+		TraceThread = std::thread(TraceThreadProc);
+		TraceRunning = true;
+	}
+}
+
+void
+TraceLog::Stop()
+{
+	if (!TraceRunning) {
+		return;
+	}
+
+	TraceRunning = false;
+
+	// Writers which have seen the log running must publish their records before the last drain
+	while (ActiveWriters.load() != 0) {
+		std::this_thread::yield();
+	}
+
+	TraceStopRequested = true;
+	TraceThread.join();
+
+	if (DroppedRecords != 0) {
+		dbg::Warning("Trace log buffer was overflowed ({} records dropped).", DroppedRecords.load());
+	}
+}
+
+namespace dbg
+{
+
+bool
+IsTraceLogRunning()
+{
+	return TraceLog::IsRunning();
+}
+
+void
+WriteTraceMessage(spdlog::level::level_enum level, std::string&& message)
+{
+	TraceRecord record = { ETraceEvent::Message, { static_cast<std::uint32_t>(level) }, new std::string(std::move(message)) };
+	if (!TraceLog::Write(record)) {
+		// Messages are never dropped, even if they will be out of order
+		WriteMessage(level, *record.Message);
+		delete record.Message;
+	}
+}
+
+}
+
+bool
+TraceLog::IsRunning()
+{
+	return TraceRunning.load(std::memory_order_relaxed);
+}
+
+bool
+TraceLog::Write(const TraceRecord& record)
+{
+	struct ActiveWriterScope
+	{
+		ActiveWriterScope() { ActiveWriters.fetch_add(1); }
+		~ActiveWriterScope() { ActiveWriters.fetch_sub(1); }
+	} activeWriterScope;
+
+	// The log could be stopped after the caller has checked it, the record isn't published then
+	if (!TraceRunning.load()) {
+		return false;
+	}
+
+	std::size_t position = WritePosition.load(std::memory_order_relaxed);
+	while (true) {
+		TraceCell& cell = TraceBuffer[position & (TraceBufferSize - 1)];
+		const std::size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+		const std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+		if (difference == 0) {
+			if (WritePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				cell.Record = record;
+				cell.Sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (difference < 0) {
+			DroppedRecords.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		} else {
+			position = WritePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+}
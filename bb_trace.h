@@ -0,0 +1,106 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2022-2023. All rights reserved.
+* nfrage - engine code for NFRage project
+**********************************************************************
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+* 
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+* 
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free 
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor, 
+* Boston, MA 02110-1301 USA
+*****************************************************************/
+#pragma once
+
+namespace bb
+{
+
+enum class ETraceEvent : std::uint32_t
+{
+	Message,			// log level, preformatted message
+	FileEntry,			// hash, checksum
+	ChunkBegin,			// chunk id, chunk size
+	TexturePackEntry,	// name hash, padding
+	TextureStreamEntry,	// name hash
+	TextureInfoEntry,	// name hash (debug name in the message)
+	TextureLoad,		// name hash, width, height, image size, mip levels, format (name in the message)
+};
+
+struct TraceRecord
+{
+	ETraceEvent Event;
+	std::uint32_t Args[7];
+	std::string* Message;	// owned by the record, nullptr if the event has no text
+};
+
+// Binary trace log for hot paths. Writers push fixed-size records into a lock-free
+// ring buffer, names are resolved and strings are formatted on the background thread.
+// If the ring buffer is full, records are dropped instead of blocking the writer.
+class TraceLog
+{
+public:
+	static void Start();
+	static void Stop();
+
+	static bool IsRunning();
+
+	// Returns false if the record was dropped
+	static bool Write(const TraceRecord& record);
+};
+
+class TraceLogScope
+{
+public:
+	TraceLogScope()
+	{
+		TraceLog::Start();
+	}
+
+	~TraceLogScope()
+	{
+		TraceLog::Stop();
+	}
+};
+
+namespace dbg
+{
+	template<typename... Args>
+	inline void Trace(ETraceEvent event, Args... args)
+	{
+		if constexpr (TraceEnabled) {
+			static_assert(sizeof...(Args) <= 7, "Too many arguments for trace record");
+			if (!TraceLog::IsRunning()) {
+				return;
+			}
+
+			TraceRecord record = { event, { static_cast<std::uint32_t>(args)... }, nullptr };
+			TraceLog::Write(record);
+		}
+	}
+
+	// Names which can't be resolved from hashes later are passed in the message slot
+	template<typename... Args>
+	inline void TraceNamed(ETraceEvent event, const char* name, Args... args)
+	{
+		if constexpr (TraceEnabled) {
+			static_assert(sizeof...(Args) <= 7, "Too many arguments for trace record");
+			if (!TraceLog::IsRunning()) {
+				return;
+			}
+
+			TraceRecord record = { event, { static_cast<std::uint32_t>(args)... }, new std::string(name) };
+			if (!TraceLog::Write(record)) {
+				delete record.Message;
+			}
+		}
+	}
+}
+
+}
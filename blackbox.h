@@ -47,29 +47,82 @@ extern "C"
 extern BLACKBOX_PLUGIN_API spdlog::logger* GameLogger;
 extern BLACKBOX_PLUGIN_API nfr::api::IEngineFactory* EngineFactory;
 
+// Trace logging is compiled out of release builds unless BLACKBOX_TRACE is set explicitly
+#ifndef BLACKBOX_TRACE
+#ifdef NDEBUG
+#define BLACKBOX_TRACE 0
+#else
+#define BLACKBOX_TRACE 1
+#endif
+#endif
+
 namespace bb::dbg
 {
+	constexpr bool TraceEnabled = BLACKBOX_TRACE;
+
+	// While the trace log is running, messages are passed to the logger from
+	// the trace log thread to keep them ordered with binary trace records
+	bool IsTraceLogRunning();
+	void WriteTraceMessage(spdlog::level::level_enum level, std::string&& message);
+
+	template<typename... Args>
+	inline void Write(spdlog::level::level_enum level, const nfr::api::string_view& fmt, Args&&... args)
+	{
+		if (IsTraceLogRunning()) {
+			WriteTraceMessage(level, spdlog::fmt_lib::vformat(fmt, spdlog::fmt_lib::make_format_args(args...)));
+			return;
+		}
+
+		switch (level) {
+		case spdlog::level::trace:
+			GameLogger->trace(fmt, std::forward<Args>(args)...);
+			break;
+		case spdlog::level::info:
+			GameLogger->info(fmt, std::forward<Args>(args)...);
+			break;
+		case spdlog::level::warn:
+			GameLogger->warn(fmt, std::forward<Args>(args)...);
+			break;
+		default:
+			GameLogger->error(fmt, std::forward<Args>(args)...);
+			break;
+		}
+	}
+
+	inline bool IsVerboseEnabled()
+	{
+		if constexpr (TraceEnabled) {
+			return GameLogger->should_log(spdlog::level::trace);
+		} else {
+			return false;
+		}
+	}
+
 	template<typename... Args>
 	inline void Verbose(const nfr::api::string_view& fmt, Args&&... args)
 	{
-		GameLogger->trace(fmt, std::forward<Args>(args)...);
+		if constexpr (TraceEnabled) {
+			if (IsVerboseEnabled()) {
+				Write(spdlog::level::trace, fmt, std::forward<Args>(args)...);
+			}
+		}
 	}
 
 	template<typename... Args>
 	inline void Log(const nfr::api::string_view& fmt, Args&&... args)
 	{
-		GameLogger->info(fmt, std::forward<Args>(args)...);
+		Write(spdlog::level::info, fmt, std::forward<Args>(args)...);
 	}
 
 	template<typename... Args>
 	inline void Error(const nfr::api::string_view& fmt, Args&&... args)
 	{
-		GameLogger->error(fmt, std::forward<Args>(args)...);
+		Write(spdlog::level::err, fmt, std::forward<Args>(args)...);
 	}
 
 	template<typename... Args>
 	inline void Warning(const nfr::api::string_view& fmt, Args&&... args)
 	{
-		GameLogger->warn(fmt, std::forward<Args>(args)...);
+		Write(spdlog::level::warn, fmt, std::forward<Args>(args)...);
 	}
 }
\ No newline at end of file
@@ -19,6 +19,9 @@ bool BBGamePluginInstance::initialize()
 		GameLogger = reinterpret_cast<spdlog::logger*>(EngineFactory->getGameLogger());
 	}
 
+	TraceLogScope traceLogScope;
+	ThreadPoolScope threadPoolScope;
+
 	auto createDirectories = [](const char* pathToAppend) {
 		nfr::api::path resourcesDirectory = EngineFactory->getResourcesDirectory();
 		resourcesDirectory.append(pathToAppend);
@@ -37,6 +40,21 @@ bool BBGamePluginInstance::initialize()
 	createDirectories("movies");
 	createDirectories("ui");
 
+	// Settings are applied before the cache is loaded, the cache depends on them
+	if (EngineFactory->exists(SettingsFileName)) {
+		LoadSettings(SettingsFileName);
+	}
+
+	nfr::api::path cacheFilePath = EngineFactory->getResourcesDirectory();
+	cacheFilePath.append("textures");
+	cacheFilePath.append("conversion_cache.bin");
+	if (EngineFactory->exists(cacheFilePath)) {
+		nfr::api::SafeInterface<nfr::api::IStream> cacheStream = EngineFactory->openFile(nfr::api::EStreamFlags::ReadFlag, cacheFilePath);
+		if (cacheStream->isOpen() && !TextureConversionCache::Load(cacheStream.get())) {
+			TextureConversionCache::Reset();
+		}
+	}
+
 	if (EngineFactory->exists("NFS/ZDIR.BIN")) {
 		dbg::Verbose("");
 		dbg::Verbose("#################################################");
@@ -78,6 +96,50 @@ bool BBGamePluginInstance::initialize()
 		if (!LoadCompressedFile("GLOBAL/GlobalB.lzc")) {
 			return false;
 		}
+
+		ChunkProfiler::LogReport();
+		TextureDeduplicator::LogReport();
+		TextureStreamer::LogReport();
+		if (TextureConversionCache::GetSkippedCount() != 0) {
+			dbg::Log("{} textures weren't changed since the last run and were skipped.", TextureConversionCache::GetSkippedCount());
+		}
+
+		if (EngineFactory->exists(cacheFilePath)) {
+			std::filesystem::remove(cacheFilePath);
+		}
+
+		nfr::api::SafeInterface<nfr::api::IStream> cacheStream = EngineFactory->openFile(nfr::api::EStreamFlags::WriteFlag, cacheFilePath);
+		if (!cacheStream->isOpen() || !TextureConversionCache::Save(cacheStream.get())) {
+			dbg::Warning("Can't write texture conversion cache to \"{}\".", cacheFilePath.generic_string());
+		}
+
+		// Aliases of the previous run are removed even if there are no new ones
+		nfr::api::path aliasesFilePath = EngineFactory->getResourcesDirectory();
+		aliasesFilePath.append("textures");
+		aliasesFilePath.append("aliases.json");
+		if (EngineFactory->exists(aliasesFilePath)) {
+			std::filesystem::remove(aliasesFilePath);
+		}
+
+		if (TextureDeduplicator::GetAliasesCount() != 0) {
+			nfr::api::SafeInterface<nfr::api::IStream> aliasesStream = EngineFactory->openFile(nfr::api::EStreamFlags::WriteFlag, aliasesFilePath);
+			if (!aliasesStream->isOpen() || !TextureDeduplicator::WriteAliases(aliasesStream.get())) {
+				dbg::Warning("Can't write texture aliases to \"{}\".", aliasesFilePath.generic_string());
+			}
+		}
+
+#ifdef NFRAGE_TOOLS
+		nfr::api::path statsFilePath = EngineFactory->getResourcesDirectory();
+		statsFilePath.append("chunk_stats.json");
+		if (EngineFactory->exists(statsFilePath)) {
+			std::filesystem::remove(statsFilePath);
+		}
+
+		nfr::api::SafeInterface<nfr::api::IStream> statsStream = EngineFactory->openFile(nfr::api::EStreamFlags::WriteFlag, statsFilePath);
+		if (!statsStream->isOpen() || !ChunkProfiler::WriteJsonReport(statsStream.get())) {
+			dbg::Warning("Can't write chunks loading statistics to \"{}\".", statsFilePath.generic_string());
+		}
+#endif
 	}
 
 	return true;
@@ -85,6 +147,7 @@ bool BBGamePluginInstance::initialize()
 
 void BBGamePluginInstance::destroy()
 {
+	TextureStreamer::Reset();
 }
 
 bool BBGamePluginInstance::tick(float dt)
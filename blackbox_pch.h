@@ -25,11 +25,28 @@
 #include <spdlog/spdlog.h>
 
 #include "blackbox.h"
+#include "bb_cpu.h"
 #include "bb_aware.h"
+#include "bb_trace.h"
+#include "bb_threads.h"
+#include "bb_mapped_file.h"
 #include "bb_compression.h"
 #include "bb_textures.h"
+#include "bb_bcn.h"
+#include "bb_texture_archive.h"
+#include "bb_texture_dedup.h"
+#include "bb_texture_cache.h"
 #include "bb_structs.h"
+#include "bb_texture_stream.h"
+#include "bb_texture_anim.h"
+#include "bb_texture_atlas.h"
+#include "bb_endian.h"
+#include "bb_geometry.h"
+#include "bb_mesh_optimizer.h"
+#include "bb_scenery.h"
 #include "bb_chunk.h"
+#include "bb_profiler.h"
+#include "bb_settings.h"
 #include "bb_game.h"
 #include "bb_main.h"
 